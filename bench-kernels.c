@@ -0,0 +1,221 @@
+/*
+ * Copyright (C) 2026, agent <agent@local>
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+/* Benchmark of the specialized query kernels: every list and select kernel
+ * runs on a generated data file and is compared with the generic path
+ * (filter_rows() with the print callback and get_distro() with the select
+ * callback). The answers have to be identical; the time per row of the
+ * data file is printed for both. With --check, only the answers are
+ * compared (for make test).
+ *
+ * It is built once per vendor: BENCH_VENDOR names the vendor source.
+ *
+ * Usage: bench-kernels [--check] [ROWS [REPEAT]]
+ */
+
+#ifndef BENCH_VENDOR
+#define BENCH_VENDOR "debian-distro-info.c"
+#endif
+
+#define DISTRO_INFO_NO_MAIN
+#include BENCH_VENDOR
+
+#define DEFAULT_ROWS 100000
+#define DEFAULT_REPEAT 5
+
+static const date_t bench_date = {2000, 1, 1};
+
+static char *write_data(size_t rows) {
+    char *filename = strdup("/tmp/bench-kernels.XXXXXX");
+    FILE *f;
+    size_t i;
+    int fd;
+
+    fd = mkstemp(filename);
+    if(fd < 0) {
+        perror("bench-kernels: mkstemp");
+        exit(EXIT_FAILURE);
+    }
+    f = fdopen(fd, "w");
+    fprintf(f, CSV_HEADER "\n");
+    for(i = 0; i < rows; i++) {
+        // Spread over 1900 to 2099 with some rows that have no version
+        // (like sid) and some without the later milestones.
+        unsigned int year = 1900 + (i * 7919) % 200;
+        unsigned int month = 1 + i % 12;
+        unsigned int day = 1 + i % 28;
+
+        if(i % 20 == 0) {
+            fprintf(f, ",S%zu,s%zu,%04u-%02u-%02u\n", i, i, year, month, day);
+        } else if(i % 5 == 0) {
+            fprintf(f, "%zu,S%zu,s%zu,%04u-%02u-%02u,%04u-%02u-%02u\n", i, i, i,
+                    year, month, day, year + 2, month, day);
+        } else {
+            // Every third of the others is an LTS version (for Ubuntu).
+            fprintf(f, "%zu%s,S%zu,s%zu,%04u-%02u-%02u,%04u-%02u-%02u,"
+                    "%04u-%02u-%02u,%04u-%02u-%02u,%04u-%02u-%02u\n", i,
+                    i % 3 == 0 ? " LTS" : "", i, i,
+                    year, month, day, year + 2, month, day, year + 5, month, day,
+                    year + 7, month, day, year + 9, month, day);
+        }
+    }
+    fclose(f);
+    return filename;
+}
+
+static double now(void) {
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+// Output of one run, to compare the kernel with the generic path
+static char *capture(const snapshot_t *snapshot, list_kernel_t kernel,
+                     const list_kernel_entry_t *entry, enum KERNEL_DAYS days_mode,
+                     int date_index) {
+    char *output;
+    size_t size;
+    FILE *stream = open_memstream(&output, &size);
+
+    if(kernel) {
+        kernel(stream, snapshot->table, &bench_date, date_index);
+    } else {
+        filter_rows(stream, snapshot->table, &bench_date, date_index,
+                    days_mode == KERNEL_JUST_DAYS, entry->filter, entry->print_cb);
+    }
+    fclose(stream);
+    return output;
+}
+
+static double time_list(const snapshot_t *snapshot, FILE *null, list_kernel_t kernel,
+                        const list_kernel_entry_t *entry, enum KERNEL_DAYS days_mode,
+                        int date_index, int repeat) {
+    double started = now();
+    int i;
+
+    for(i = 0; i < repeat; i++) {
+        if(kernel) {
+            kernel(null, snapshot->table, &bench_date, date_index);
+        } else {
+            filter_rows(null, snapshot->table, &bench_date, date_index,
+                        days_mode == KERNEL_JUST_DAYS, entry->filter, entry->print_cb);
+        }
+    }
+    fflush(null);
+    return (now() - started) / repeat / snapshot->table->count * 1e9;
+}
+
+static double time_select(const snapshot_t *snapshot, const select_kernel_entry_t *entry,
+                          bool generic, int repeat, const distro_t **selected) {
+    double started = now();
+    int i;
+
+    for(i = 0; i < repeat; i++) {
+        *selected = generic ? get_distro(snapshot->list, &bench_date, entry->filter,
+                                         entry->select_cb)
+                            : entry->kernel(snapshot->table, &bench_date);
+    }
+    return (now() - started) / repeat / snapshot->table->count * 1e9;
+}
+
+int main(int argc, char *argv[]) {
+    static const char *days_names[] = {"plain", "days", "just-days"};
+    bool check = argc > 1 && strcmp(argv[1], "--check") == 0;
+    size_t rows = argc > 1 + check ? strtoul(argv[1 + check], NULL, 10) : DEFAULT_ROWS;
+    int repeat = argc > 2 + check ? atoi(argv[2 + check]) : DEFAULT_REPEAT;
+    snapshot_t *snapshot;
+    char *filename;
+    FILE *null;
+    int failures = 0;
+    size_t i;
+    int days_mode;
+
+    if(rows == 0 || repeat < 1) {
+        fprintf(stderr, "Usage: bench-kernels [--check] [ROWS [REPEAT]]\n");
+        return EXIT_FAILURE;
+    }
+    filename = write_data(rows);
+    snapshot = snapshot_load(filename);
+    unlink(filename);
+    free(filename);
+    if(snapshot == NULL) {
+        return EXIT_FAILURE;
+    }
+    null = fopen("/dev/null", "w");
+
+    if(!check) {
+        printf(CSV_NAME ": %zu rows, ns per row\n", rows);
+        printf("%-28s %-10s %10s %10s %8s\n", "kernel", "days", "generic", "kernel",
+               "speedup");
+    }
+    for(i = 0; i < LIST_KERNEL_COUNT; i++) {
+        const list_kernel_entry_t *entry = &list_kernels[i];
+
+        for(days_mode = 0; days_mode < KERNEL_DAYS_COUNT; days_mode++) {
+            int date_index = days_mode == KERNEL_PLAIN ? -1 : MILESTONE_EOL;
+            list_kernel_t kernel = entry->kernels[days_mode];
+            char *expected = capture(snapshot, NULL, entry, days_mode, date_index);
+            char *actual = capture(snapshot, kernel, entry, days_mode, date_index);
+            double generic_ns;
+            double kernel_ns;
+
+            if(strcmp(expected, actual) != 0) {
+                fprintf(stderr, "bench-kernels: " CSV_NAME ": %s (%s) differs from the generic "
+                        "path.\n", entry->name, days_names[days_mode]);
+                failures++;
+            }
+            free(expected);
+            free(actual);
+            if(check) {
+                continue;
+            }
+            generic_ns = time_list(snapshot, null, NULL, entry, days_mode,
+                                   date_index, repeat);
+            kernel_ns = time_list(snapshot, null, kernel, entry, days_mode,
+                                  date_index, repeat);
+            printf("%-28s %-10s %10.1f %10.1f %7.2fx\n", entry->name,
+                   days_names[days_mode], generic_ns, kernel_ns, generic_ns / kernel_ns);
+        }
+    }
+    for(i = 0; i < SELECT_KERNEL_COUNT; i++) {
+        const distro_t *expected;
+        const distro_t *actual;
+        double generic_ns = time_select(snapshot, &select_kernels[i], true,
+                                        check ? 1 : repeat, &expected);
+        double kernel_ns = time_select(snapshot, &select_kernels[i], false,
+                                       check ? 1 : repeat, &actual);
+
+        if(expected != actual) {
+            fprintf(stderr, "bench-kernels: " CSV_NAME ": %s differs from the generic path.\n",
+                    select_kernels[i].name);
+            failures++;
+        }
+        if(check) {
+            continue;
+        }
+        printf("%-28s %-10s %10.1f %10.1f %7.2fx\n", select_kernels[i].name, "-",
+               generic_ns, kernel_ns, generic_ns / kernel_ns);
+    }
+
+    if(check && failures == 0) {
+        printf(CSV_NAME ": %zu list and %zu select kernels match the generic path.\n",
+               (size_t)LIST_KERNEL_COUNT * KERNEL_DAYS_COUNT, (size_t)SELECT_KERNEL_COUNT);
+    }
+    fclose(null);
+    snapshot_release(snapshot);
+    return failures == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -20,47 +20,12 @@
 #define DISTRO_NAME "Debian"
 #define NAME "debian-distro-info"
 
+// fopencookie() for the output of the parallel workers
+#define _GNU_SOURCE
+
 // C standard libraries
 #include <stdlib.h>
 
 #include "distro-info-util.h"
 
-static bool filter_devel(const date_t *date, const distro_t *distro) {
-    return created(date, distro) && !released(date, distro) &&
-           *distro->version == '\0';
-}
-
-static bool filter_oldstable(const date_t *date, const distro_t *distro) {
-    return created(date, distro) && released(date, distro);
-}
-
-static bool filter_testing(const date_t *date, const distro_t *distro) {
-    return created(date, distro) && !released(date, distro);
-}
-
-static const distro_t *select_first(const distro_elem_t *distro_list) {
-    return distro_list->distro;
-}
-
-static const distro_t *select_oldstable(const distro_elem_t *distro_list) {
-    const distro_t *newest;
-    const distro_t *second = NULL;
-
-    newest = distro_list->distro;
-    while(distro_list != NULL) {
-        distro_list = distro_list->next;
-        if(distro_list) {
-            if(date_ge(distro_list->distro->milestones[MILESTONE_RELEASE],
-                       newest->milestones[MILESTONE_RELEASE])) {
-                second = newest;
-                newest = distro_list->distro;
-            } else if(second && date_ge(distro_list->distro->milestones[MILESTONE_RELEASE],
-                                        second->milestones[MILESTONE_RELEASE])) {
-                second = distro_list->distro;
-            }
-        }
-    }
-    return second;
-}
-
 #include "distro-info-util.c"
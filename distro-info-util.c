@@ -16,37 +16,42 @@
 
 // C standard libraries
 #include <assert.h>
+#include <ctype.h>
 #include <errno.h>
+#include <inttypes.h>
 #include <stdbool.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <time.h>
 
+#include <fcntl.h>
 #include <getopt.h>
+#include <pthread.h>
+#include <sched.h>
+#include <signal.h>
+#include <sys/mman.h>
 #include <sys/stat.h>
 #include <sys/types.h>
 #include <unistd.h>
 
+#ifdef __linux__
+#include <poll.h>
+#include <sys/inotify.h>
+#include <sys/timerfd.h>
+#endif
+
 #include "distro-info-util.h"
 
+#define MILESTONE_NAME(id, name) name,
+
 /* All recognised dated database tags for milestones
  * (corresponding to distro_t date_t's).
- *
- * NOTE: Must be kept in sync with MILESTONE enum.
  */
-static char *milestones[] = {"created"
-                            ,"release"
-                            ,"eol"
-#ifdef DEBIAN
-                            ,"eol-lts"
-                            ,"eol-elts"
-#endif
-#ifdef UBUNTU
-                            ,"eol-server"
-                            ,"eol-esm"
-#endif
-};
+static char *milestones[] = {VENDOR_MILESTONES(MILESTONE_NAME)};
+
+/* Names of the predicates usable in --query expressions. */
+static char *predicates[] = {VENDOR_PREDICATES(MILESTONE_NAME)};
 
 static unsigned int days_in_month[] = {31, 28, 31, 30, 31, 30,
                                        31, 31, 30, 31, 30, 31};
@@ -69,6 +74,34 @@ static inline char *index_to_milestone(unsigned int i) {
     return milestones[i];
 }
 
+static inline unsigned int lowest_bit(uint64_t word) {
+#ifdef __GNUC__
+    return __builtin_ctzll(word);
+#else
+    unsigned int bit = 0;
+
+    while(!(word & 1)) {
+        word >>= 1;
+        bit++;
+    }
+    return bit;
+#endif
+}
+
+static inline unsigned int highest_bit(uint64_t word) {
+#ifdef __GNUC__
+    return 63 - __builtin_clzll(word);
+#else
+    unsigned int bit = 63;
+
+    while(!(word & ((uint64_t)1 << 63))) {
+        word <<= 1;
+        bit--;
+    }
+    return bit;
+#endif
+}
+
 static char *read_full_file(const char *filename) {
     char *content;
     FILE *f;
@@ -87,14 +120,15 @@ static char *read_full_file(const char *filename) {
         return NULL;
     }
     size = stat.st_size;
-    content = malloc(size + 1);
+    // Padded with zeros so that the tokenizer can always scan whole blocks.
+    content = malloc(size + CSV_BLOCK);
     if(unlikely(fread(content, sizeof(char), size, f) != size)) {
         fprintf(stderr, NAME ": Failed to read %zu bytes from %s.\n", size,
                 filename);
         free(content);
         return NULL;
     }
-    content[size] = '\0';
+    memset(content + size, '\0', CSV_BLOCK);
     fclose(f);
     return content;
 }
@@ -104,12 +138,43 @@ static inline bool is_leap_year(const int year) {
 }
 
 static inline bool is_valid_date(const date_t *date) {
-    return date->month >= 1 && date->month <= 12 &&
+    return date->year <= DATEKEY_YEAR_MAX &&
+           date->month >= 1 && date->month <= 12 &&
            date->day >= 1 &&
            date->day <= (is_leap_year(date->year) &&
            date->month == 2 ? 29 : days_in_month[date->month-1]);
 }
 
+/* Decode a date in the fixed-width YYYY-MM-DD form (the only one used in
+ * the data files) without sscanf. Everything else that sscanf accepts is
+ * passed on to it.
+ */
+static inline bool scan_date(const char *s, date_t *date) {
+    unsigned int digits[8];
+    unsigned int invalid;
+    int i;
+
+    if(likely(strnlen(s, 11) == 10 && s[4] == '-' && s[7] == '-')) {
+        invalid = 0;
+        for(i = 0; i < 8; i++) {
+            digits[i] = (unsigned char)s[i + (i >= 4) + (i >= 6)] - '0';
+            invalid |= digits[i] > 9;
+        }
+        if(likely(!invalid)) {
+            date->year = digits[0] * 1000 + digits[1] * 100 + digits[2] * 10 +
+                         digits[3];
+            date->month = digits[4] * 10 + digits[5];
+            date->day = digits[6] * 10 + digits[7];
+            return true;
+        }
+    }
+    return sscanf(s, "%u-%u-%u", &date->year, &date->month, &date->day) == 3;
+}
+
+static bool parse_date(const char *s, date_t *date) {
+    return scan_date(s, date) && is_valid_date(date);
+}
+
 static time_t date_to_secs(const date_t *date) {
     time_t seconds = 0;
     struct tm tm;
@@ -127,15 +192,10 @@ static time_t date_to_secs(const date_t *date) {
     return seconds;
 }
 
-static inline size_t date_diff(const date_t *date1, const date_t *date2) {
-    time_t time1;
-    time_t time2;
+static inline size_t secs_diff(time_t time1, time_t time2) {
     time_t diff;
     unsigned int days;
 
-    time1 = date_to_secs(date1);
-    time2 = date_to_secs(date2);
-
     diff = (time_t)difftime(time1, time2);
 
     days = (unsigned int)diff / (60 * 60 * 24);
@@ -143,26 +203,76 @@ static inline size_t date_diff(const date_t *date1, const date_t *date2) {
     return days;
 }
 
+static inline size_t date_diff(const date_t *date1, const date_t *date2) {
+    return secs_diff(date_to_secs(date1), date_to_secs(date2));
+}
+
 static inline bool is_valid_codename(const char *codename) {
     // Only codenames with lowercase ASCII letters are accepted
     return strlen(codename) > 0 &&
            strspn(codename, "abcdefghijklmnopqrstuvwxyz") == strlen(codename);
 }
 
+static void *arena_alloc(arena_t *arena, size_t size) {
+    arena_block_t *block = arena->blocks;
+    void *pointer;
+
+    // Counted in words, so that every allocation is 8 byte aligned.
+    size = (size + sizeof(uint64_t) - 1) / sizeof(uint64_t);
+    if(block == NULL || block->used + size > block->size) {
+        block = malloc(sizeof(arena_block_t) +
+                       (size > ARENA_BLOCK ? size : ARENA_BLOCK) * sizeof(uint64_t));
+        block->next = arena->blocks;
+        block->size = size > ARENA_BLOCK ? size : ARENA_BLOCK;
+        block->used = 0;
+        arena->blocks = block;
+    }
+    pointer = block->data + block->used;
+    block->used += size;
+    return pointer;
+}
+
+// Free everything but the last block, which is kept for reuse.
+static void arena_reset(arena_t *arena) {
+    arena_block_t *block;
+
+    if(arena->blocks == NULL) {
+        return;
+    }
+    while(arena->blocks->next != NULL) {
+        block = arena->blocks->next;
+        arena->blocks->next = block->next;
+        free(block);
+    }
+    arena->blocks->used = 0;
+}
+
+static void arena_free(arena_t *arena) {
+    arena_reset(arena);
+    free(arena->blocks);
+    arena->blocks = NULL;
+}
+
+static inline void *row_alloc(row_parser_t *parser, size_t size) {
+    return parser->arena ? arena_alloc(parser->arena, size) : malloc(size);
+}
+
 // Read an ISO 8601 formatted date
-static date_t *read_date(const char *s, int *failures, const char *filename,
-                         const int lineno, const char *column) {
+static date_t *read_date(const char *s, row_parser_t *parser, const int lineno,
+                         const char *column) {
     date_t *date = NULL;
-    int n;
 
     if(s) {
-        date = malloc(sizeof(date_t));
-        n = sscanf(s, "%u-%u-%u", &date->year, &date->month, &date->day);
-        if(unlikely(n != 3 || !is_valid_date(date))) {
-            fprintf(stderr, NAME ": Invalid date `%s' in file `%s' at line %i "
-                    "in column `%s'.\n", s, filename, lineno, column);
-            (*failures)++;
-            free(date);
+        date = row_alloc(parser, sizeof(date_t));
+        if(unlikely(!parse_date(s, date))) {
+            if(!parser->quiet) {
+                fprintf(stderr, NAME ": Invalid date `%s' in file `%s' at line %i "
+                        "in column `%s'.\n", s, parser->filename, lineno, column);
+            }
+            parser->failures++;
+            if(parser->arena == NULL) {
+                free(date);
+            }
             date = NULL;
         }
     }
@@ -176,88 +286,70 @@ static inline bool date_ge(const date_t *date1, const date_t *date2) {
             date1->day >= date2->day);
 }
 
-static inline bool created(const date_t *date, const distro_t *distro) {
-    return distro->milestones[MILESTONE_CREATED] &&
-           date_ge(date, distro->milestones[MILESTONE_CREATED]);
+// Whether milestone_index of distro is known and reached on date
+static inline bool reached(const date_t *date, const distro_t *distro,
+                           int milestone_index) {
+    return distro->milestones[milestone_index] &&
+           date_ge(date, distro->milestones[milestone_index]);
 }
 
-static inline bool released(const date_t *date, const distro_t *distro) {
-    return *distro->version != '\0' &&
-           distro->milestones[MILESTONE_RELEASE] &&
-           date_ge(date, distro->milestones[MILESTONE_RELEASE]);
+// Whether milestone_index of distro is reached on date or unknown
+static inline bool passed(const date_t *date, const distro_t *distro,
+                          int milestone_index) {
+    return !distro->milestones[milestone_index] ||
+           date_ge(date, distro->milestones[milestone_index]);
 }
 
-static inline bool eol(const date_t *date, const distro_t *distro) {
-    return distro->milestones[MILESTONE_EOL] &&
-           date_ge(date, distro->milestones[MILESTONE_EOL])
-#ifdef UBUNTU
-           && (!distro->milestones[MILESTONE_EOL_SERVER] ||
-              (distro->milestones[MILESTONE_EOL_SERVER] &&
-               date_ge(date, distro->milestones[MILESTONE_EOL_SERVER])))
-#endif
-    ;
-}
+#define ROW_REACHED(milestone) reached(date, distro, MILESTONE_##milestone)
+#define ROW_PASSED(milestone) passed(date, distro, MILESTONE_##milestone)
+#define ROW_RULE(predicate, condition) \
+    if(condition) { \
+        predicates |= PREDICATE(predicate); \
+    }
 
-#ifdef DEBIAN
-static inline bool eol_lts(const date_t *date, const distro_t *distro) {
-    return !distro->milestones[MILESTONE_EOL_LTS] ||
-           date_ge(date, distro->milestones[MILESTONE_EOL_LTS])
-    ;
-}
+static unsigned int row_predicates(const date_t *date, const distro_t *distro) {
+    const bool versioned = *distro->version != '\0';
+    unsigned int predicates = 0;
 
-static inline bool eol_elts(const date_t *date, const distro_t *distro) {
-    return !distro->milestones[MILESTONE_EOL_ELTS] ||
-           date_ge(date, distro->milestones[MILESTONE_EOL_ELTS])
-    ;
+    VENDOR_RULES(ROW_RULE, ROW_REACHED, ROW_PASSED, versioned,
+                 strstr(distro->version, "LTS") != NULL)
+    return predicates;
 }
-#endif
 
-#ifdef UBUNTU
-static inline bool eol_esm(const date_t *date, const distro_t *distro) {
-    return distro->milestones[MILESTONE_EOL] &&
-           date_ge(date, distro->milestones[MILESTONE_EOL])
-           && (!distro->milestones[MILESTONE_EOL_ESM] ||
-              (distro->milestones[MILESTONE_EOL_ESM] &&
-               date_ge(date, distro->milestones[MILESTONE_EOL_ESM])))
-    ;
+static inline bool matches(const filter_t *filter, const date_t *date,
+                           const distro_t *distro) {
+    unsigned int predicates = row_predicates(date, distro);
+
+    return (predicates & filter->require) == filter->require &&
+           (predicates & filter->exclude) == 0;
 }
-#endif
 
-// Filter callbacks
+// Filters
 
-static bool filter_all(unused(const date_t *date),
-                       unused(const distro_t *distro)) {
-    return true;
-}
+static const filter_t filter_all = {"all", 0, 0};
 
-static bool filter_stable(const date_t *date, const distro_t *distro) {
-    return released(date, distro) && !eol(date, distro);
-}
+#define ROLE_FILTER(filter, role, require, exclude, select) \
+    static const filter_t filter_##filter = {#filter, require, exclude};
 
-static bool filter_supported(const date_t *date, const distro_t *distro) {
-    return created(date, distro) && !eol(date, distro);
-}
+VENDOR_ROLES(ROLE_FILTER, PREDICATE)
+
+static const filter_t filter_supported = {"supported", PREDICATE(CREATED), PREDICATE(EOL)};
 
 #ifdef DEBIAN
-static bool filter_lts_supported(const date_t *date, const distro_t *distro) {
-    return created(date, distro) && eol(date, distro) && !eol_lts(date, distro);
-}
+static const filter_t filter_lts_supported = {"lts", PREDICATE(CREATED) | PREDICATE(EOL),
+                                              PREDICATE(EOL_LTS)};
 
-static bool filter_elts_supported(const date_t *date, const distro_t *distro) {
-    return created(date, distro) && eol_lts(date, distro) && !eol_elts(date, distro);
-}
+static const filter_t filter_elts_supported = {"elts", PREDICATE(CREATED) | PREDICATE(EOL_LTS),
+                                               PREDICATE(EOL_ELTS)};
 #endif
 
 #ifdef UBUNTU
-static bool filter_esm_supported(const date_t *date, const distro_t *distro) {
-    return created(date, distro) && !eol_esm(date, distro) &&
-           strstr(distro->version, "LTS") != NULL;
-}
+static const filter_t filter_esm_supported = {"supported-esm",
+                                              PREDICATE(CREATED) | PREDICATE(LTS),
+                                              PREDICATE(EOL_ESM)};
 #endif
 
-static bool filter_unsupported(const date_t *date, const distro_t *distro) {
-    return created(date, distro) && eol(date, distro);
-}
+static const filter_t filter_unsupported = {"unsupported", PREDICATE(CREATED) | PREDICATE(EOL), 0};
 
 // Select callbacks
 
@@ -289,6 +381,31 @@ static const distro_t *select_latest_release(const distro_elem_t *distro_list) {
     return selected;
 }
 
+static const distro_t *select_first(const distro_elem_t *distro_list) {
+    return distro_list->distro;
+}
+
+static const distro_t *select_oldstable(const distro_elem_t *distro_list) {
+    const distro_t *newest;
+    const distro_t *second = NULL;
+
+    newest = distro_list->distro;
+    while(distro_list != NULL) {
+        distro_list = distro_list->next;
+        if(distro_list) {
+            if(date_ge(distro_list->distro->milestones[MILESTONE_RELEASE],
+                       newest->milestones[MILESTONE_RELEASE])) {
+                second = newest;
+                newest = distro_list->distro;
+            } else if(second && date_ge(distro_list->distro->milestones[MILESTONE_RELEASE],
+                                        second->milestones[MILESTONE_RELEASE])) {
+                second = distro_list->distro;
+            }
+        }
+    }
+    return second;
+}
+
 static const distro_t *select_series(const distro_elem_t *distro_list, const char *series) {
     const distro_t *selected;
 
@@ -334,100 +451,104 @@ static bool calculate_days(const distro_t *distro, const date_t *date,
 
 // Print callbacks
 
-static bool print_codename(const distro_t *distro, const date_t *date,
-                           int date_index, int just_days) {
+static bool print_codename(FILE *stream, const distro_t *distro,
+                           const date_t *date, int date_index, int just_days) {
     ssize_t days;
 
     if(date_index == -1) {
-        printf("%s\n", distro->series);
+        fprintf(stream, "%s\n", distro->series);
     } else {
         if(!calculate_days(distro, date, date_index, &days)) {
-            printf("%s%s%s\n",
-                    just_days ? "" : distro->series,
-                    just_days ? "" : " ",
-                    UNKNOWN_DAYS);
+            fprintf(stream, "%s%s%s\n",
+                     just_days ? "" : distro->series,
+                     just_days ? "" : " ",
+                     UNKNOWN_DAYS);
         } else {
-            printf("%s%s%zd\n",
-                    just_days ? "" : distro->series,
-                    just_days ? "" : " ",
-                    days);
+            fprintf(stream, "%s%s%zd\n",
+                     just_days ? "" : distro->series,
+                     just_days ? "" : " ",
+                     days);
         }
     }
 
-    return true;
+    return !ferror(stream);
 }
 
-static bool print_fullname(const distro_t *distro, const date_t *date,
-                           int date_index, int just_days) {
+static bool print_fullname(FILE *stream, const distro_t *distro,
+                           const date_t *date, int date_index, int just_days) {
     ssize_t days;
 
     if(date_index == -1) {
-        printf(DISTRO_NAME " %s \"%s\"\n", distro->version, distro->codename);
+        fprintf(stream, DISTRO_NAME " %s \"%s\"\n", distro->version, distro->codename);
     } else {
         if(!calculate_days(distro, date, date_index, &days)) {
             if(just_days) {
-                printf("%s\n", UNKNOWN_DAYS);
+                fprintf(stream, "%s\n", UNKNOWN_DAYS);
             } else {
-                printf(DISTRO_NAME " %s \"%s\" %s\n",
-                       distro->version, distro->codename, UNKNOWN_DAYS);
+                fprintf(stream, DISTRO_NAME " %s \"%s\" %s\n",
+                        distro->version, distro->codename, UNKNOWN_DAYS);
             }
         } else {
             if(just_days) {
-                printf("%zd\n", days);
+                fprintf(stream, "%zd\n", days);
             } else {
-                printf(DISTRO_NAME " %s \"%s\" %zd\n",
-                       distro->version, distro->codename, days);
+                fprintf(stream, DISTRO_NAME " %s \"%s\" %zd\n",
+                        distro->version, distro->codename, days);
             }
         }
     }
-    return true;
+    return !ferror(stream);
 }
 
-static bool print_release(const distro_t *distro, const date_t *date,
-                          int date_index, int just_days) {
+static bool print_release(FILE *stream, const distro_t *distro,
+                          const date_t *date, int date_index, int just_days) {
     ssize_t days;
     char *str;
 
     str = unlikely(*distro->version == '\0') ? distro->series : distro->version;
 
     if(date_index == -1) {
-        printf("%s\n", str);
+        fprintf(stream, "%s\n", str);
     } else {
         if(!calculate_days(distro, date, date_index, &days)) {
-            printf("%s%s%s\n",
-                   just_days ? "" : str,
-                   just_days ? "" : " ",
-                   UNKNOWN_DAYS);
+            fprintf(stream, "%s%s%s\n",
+                    just_days ? "" : str,
+                    just_days ? "" : " ",
+                    UNKNOWN_DAYS);
         } else {
-            printf("%s%s%zd\n",
-                   just_days ? "" : str,
-                   just_days ? "" : " ",
-                   days);
+            fprintf(stream, "%s%s%zd\n",
+                    just_days ? "" : str,
+                    just_days ? "" : " ",
+                    days);
         }
     }
 
-    return true;
+    return !ferror(stream);
 }
 
 // End of callbacks
 
+static void free_distro(distro_t *distro) {
+    free(distro->milestones[MILESTONE_CREATED]);
+    free(distro->milestones[MILESTONE_RELEASE]);
+    free(distro->milestones[MILESTONE_EOL]);
+#ifdef DEBIAN
+    free(distro->milestones[MILESTONE_EOL_LTS]);
+    free(distro->milestones[MILESTONE_EOL_ELTS]);
+#endif
+#ifdef UBUNTU
+    free(distro->milestones[MILESTONE_EOL_SERVER]);
+    free(distro->milestones[MILESTONE_EOL_ESM]);
+#endif
+    free(distro);
+}
+
 static void free_data(distro_elem_t *list, char **content) {
     distro_elem_t *next;
 
     while(list != NULL) {
         next = list->next;
-        free(list->distro->milestones[MILESTONE_CREATED]);
-        free(list->distro->milestones[MILESTONE_RELEASE]);
-        free(list->distro->milestones[MILESTONE_EOL]);
-#ifdef DEBIAN
-        free(list->distro->milestones[MILESTONE_EOL_LTS]);
-        free(list->distro->milestones[MILESTONE_EOL_ELTS]);
-#endif
-#ifdef UBUNTU
-        free(list->distro->milestones[MILESTONE_EOL_SERVER]);
-        free(list->distro->milestones[MILESTONE_EOL_ESM]);
-#endif
-        free(list->distro);
+        free_distro(list->distro);
         free(list);
         list = next;
     }
@@ -436,61 +557,169 @@ static void free_data(distro_elem_t *list, char **content) {
     *content = NULL;
 }
 
-static distro_elem_t *read_data(const char *filename, char **content) {
-    char *data;
+/* Return a bit set of the commas and newlines in the CSV_BLOCK bytes at
+ * block.
+ */
+vectorized static uint64_t csv_separators(const char *block) {
+    uint64_t word = 0;
+    int i;
+
+    for(i = 0; i < CSV_BLOCK; i++) {
+        word |= (uint64_t)(block[i] == ',' || block[i] == '\n') << i;
+    }
+    return word;
+}
+
+static void csv_start(csv_reader_t *reader, char *data, char *end) {
+    reader->next = data;
+    reader->block = data;
+    reader->end = end;
+    reader->sep = data < end ? csv_separators(data) : 0;
+}
+
+/* Return the next field (or NULL at the end of the data) and store the
+ * character that terminated it (',', '\n' or '\0' at the end of the data)
+ * in separator. Like strsep(), the field is terminated in place.
+ */
+static char *csv_field(csv_reader_t *reader, char *separator) {
+    char *field = reader->next;
+    char *position;
+
+    if(field == NULL) {
+        return NULL;
+    }
+    while(reader->sep == 0) {
+        reader->block += CSV_BLOCK;
+        if(reader->block >= reader->end) {
+            reader->next = NULL;
+            *separator = '\0';
+            return field;
+        }
+        reader->sep = csv_separators(reader->block);
+    }
+    position = reader->block + lowest_bit(reader->sep);
+    if(unlikely(position >= reader->end)) {
+        // Separators after the end belong to data that is not scanned yet.
+        reader->next = NULL;
+        *separator = '\0';
+        return field;
+    }
+    reader->sep &= reader->sep - 1;
+    *separator = *position;
+    *position = '\0';
+    reader->next = position + 1;
+    return field;
+}
+
+/* Return the next field of the current line or NULL if the line has no
+ * more fields.
+ */
+static inline char *csv_next_field(csv_reader_t *reader, char *separator) {
+    return *separator == ',' ? csv_field(reader, separator) : NULL;
+}
+
+static inline void csv_skip_line(csv_reader_t *reader, char *separator) {
+    while(csv_next_field(reader, separator) != NULL) {
+    }
+}
+
+static bool check_header(const char *line, const char *header,
+                         const char *filename) {
+    if(unlikely(strncmp(header, line, strlen(header)) != 0)) {
+        fprintf(stderr, NAME ": Header `%s' in file `%s' does not start with "
+                "`%s'.\n", line, filename, header);
+        return false;
+    }
+    return true;
+}
+
+/* Parse the line that starts with field into a new distro_t, which points
+ * into the tokenized data. Returns NULL for empty lines and comments.
+ */
+static distro_t *read_row(csv_reader_t *reader, char *field, char *separator,
+                          row_parser_t *parser, int lineno) {
+    distro_t *distro;
+    int milestone_index;
+
+    // Ignore empty lines and comments (starting with #).
+    if(unlikely(*field == '\0' && *separator != ',')) {
+        return NULL;
+    }
+    if(unlikely(*field == '#')) {
+        csv_skip_line(reader, separator);
+        return NULL;
+    }
+
+    distro = row_alloc(parser, sizeof(distro_t));
+    distro->version = field;
+    distro->codename = csv_next_field(reader, separator);
+    distro->series = csv_next_field(reader, separator);
+
+    for(milestone_index = 0; milestone_index < (int)MILESTONE_COUNT;
+        milestone_index++) {
+        distro->milestones[milestone_index] =
+            read_date(csv_next_field(reader, separator), parser, lineno,
+                      parser->columns[milestone_index]);
+    }
+    // Ignore additional columns.
+    csv_skip_line(reader, separator);
+    return distro;
+}
+
+/* Parse the data in content (padded with CSV_BLOCK zeros), whose header
+ * starts with header and whose milestone columns are named columns. The
+ * rows point into content. On errors, content is freed. filename is only
+ * used for the error messages.
+ */
+static distro_elem_t *parse_csv(const char *filename, const char *header,
+                                char *const *columns, char **content) {
+    char *data = *content;
     char *line;
+    char *field;
+    char separator;
+    csv_reader_t reader;
     distro_elem_t *current;
     distro_elem_t *distro_list = NULL;
     distro_elem_t *last = NULL;
     distro_t *distro;
     int lineno;
-    int failures = 0;
+    row_parser_t parser = {filename, columns, NULL, false, 0};
 
-    data = *content = read_full_file(filename);
-    line = strsep(&data, "\n");
+    line = data;
+    data = strchr(data, '\n');
+    if(data != NULL) {
+        *data++ = '\0';
+    }
     lineno = 1;
-    if(unlikely(strncmp(CSV_HEADER, line, strlen(CSV_HEADER)) != 0)) {
-        fprintf(stderr, NAME ": Header `%s' in file `%s' does not start with "
-                "`" CSV_HEADER "'.\n", line, filename);
-        failures++;
+    if(!check_header(line, header, filename)) {
+        parser.failures++;
     }
 
-    while((line = strsep(&data, "\n")) != NULL) {
+    csv_start(&reader, data, data ? data + strlen(data) : NULL);
+    while((field = csv_field(&reader, &separator)) != NULL) {
         lineno++;
-        // Ignore empty lines and comments (starting with #).
-        if(likely(*line != '\0' && *line != '#')) {
-            int milestone_index;
-
-            distro = malloc(sizeof(distro_t));
-            distro->version = strsep(&line, ",");
-            distro->codename = strsep(&line, ",");
-            distro->series = strsep(&line, ",");
-
-            for(milestone_index = 0; milestone_index < (int)MILESTONE_COUNT;
-                milestone_index++) {
-                distro->milestones[milestone_index] =
-                    read_date(strsep(&line, ","), &failures, filename,
-                              lineno, milestones[milestone_index]);
-            }
+        distro = read_row(&reader, field, &separator, &parser, lineno);
+        if(distro == NULL) {
+            continue;
+        }
 
-            current = malloc(sizeof(distro_elem_t));
-            current->distro = distro;
-            current->next = NULL;
-            if(last == NULL) {
-                distro_list = current;
-            } else {
-                last->next = current;
-            }
-            last = current;
+        current = malloc(sizeof(distro_elem_t));
+        current->distro = distro;
+        current->next = NULL;
+        if(last == NULL) {
+            distro_list = current;
+        } else {
+            last->next = current;
         }
+        last = current;
     }
 
     if(unlikely(distro_list == NULL)) {
         fprintf(stderr, NAME ": No data found in file `%s'.\n", filename);
-        failures++;
+        parser.failures++;
     }
 
-    if(unlikely(failures > 0)) {
+    if(unlikely(parser.failures > 0)) {
         free_data(distro_list, content);
         distro_list = NULL;
     }
@@ -498,62 +727,5093 @@ static distro_elem_t *read_data(const char *filename, char **content) {
     return distro_list;
 }
 
-static bool filter_data(const distro_elem_t *distro_list, const date_t *date,
-                        int date_index, int just_days,
-                        bool (*filter_cb)(const date_t*, const distro_t*),
-                        bool (*print_cb)(const distro_t*, const date_t*, int, int)) {
-    while(distro_list != NULL) {
-        if(filter_cb(date, distro_list->distro)) {
-            if(!print_cb(distro_list->distro, date, date_index, just_days)) {
-                return false;
+/* Read a data file whose header starts with header and whose milestone
+ * columns are named columns.
+ */
+static distro_elem_t *read_csv(const char *filename, const char *header,
+                               char *const *columns, char **content) {
+    *content = read_full_file(filename);
+    if(unlikely(*content == NULL)) {
+        return NULL;
+    }
+    return parse_csv(filename, header, columns, content);
+}
+
+static inline distro_elem_t *read_data(const char *filename, char **content) {
+    return read_csv(filename, CSV_HEADER, milestones, content);
+}
+
+/* Print the rows of filename that match the filter of query at date while
+ * reading the file in chunks of STREAM_CHUNK bytes. Only the current chunk
+ * (or a longer line) is kept in memory. Rows with errors are reported and
+ * skipped, but the rows before them are already printed. Reading stops once
+ * query->limit rows are printed or the output cannot be written.
+ */
+maybe_unused static bool stream_data(const char *filename, const query_t *query,
+                                     const date_t *date) {
+    size_t capacity = STREAM_CHUNK;
+    size_t length = 0;
+    size_t n;
+    char *buffer;
+    char *start;
+    char *end;
+    char *field;
+    char separator;
+    csv_reader_t reader;
+    distro_t *distro;
+    FILE *f;
+    int lineno = 0;
+    int row_failures;
+    row_parser_t parser = {filename, milestones, NULL, false, 0};
+    size_t printed = 0;
+    bool rows = false;
+    bool eof = false;
+
+    f = fopen(filename, "r");
+    if(unlikely(f == NULL)) {
+        fprintf(stderr, NAME ": Failed to open %s: %s\n", filename,
+                strerror(errno));
+        return false;
+    }
+    buffer = malloc(capacity + CSV_BLOCK);
+
+    while(!eof) {
+        if(length == capacity) {
+            // The line does not fit into the buffer.
+            capacity *= 2;
+            buffer = realloc(buffer, capacity + CSV_BLOCK);
+        }
+        n = fread(buffer + length, 1, capacity - length, f);
+        length += n;
+        eof = n == 0;
+        memset(buffer + length, '\0', CSV_BLOCK);
+
+        // Only complete lines are tokenized; the rest waits for more data.
+        for(end = buffer + length; !eof && end > buffer && end[-1] != '\n';
+            end--) {
+        }
+        if(!eof) {
+            if(end == buffer) {
+                continue;
             }
+            end--;
+        }
+        *end = '\0';
+
+        start = buffer;
+        if(lineno == 0) {
+            lineno = 1;
+            start = strchr(buffer, '\n');
+            if(start == NULL) {
+                // The header is the last line that is complete so far.
+                start = end + 1;
+            } else {
+                *start++ = '\0';
+            }
+            if(!check_header(buffer, CSV_HEADER, filename)) {
+                parser.failures++;
+                break;
+            }
+        }
+
+        if(start <= end) {
+            csv_start(&reader, start, end);
+            while((field = csv_field(&reader, &separator)) != NULL) {
+                lineno++;
+                row_failures = parser.failures;
+                distro = read_row(&reader, field, &separator, &parser, lineno);
+                if(distro == NULL) {
+                    continue;
+                }
+                rows = true;
+                if(parser.failures == row_failures && matches(query->filter, date, distro)) {
+                    if(!query->print_cb(stdout, distro, date, query->date_index,
+                                        query->just_days)) {
+                        eof = true;
+                    }
+                    printed++;
+                    if(printed == query->limit) {
+                        eof = true;
+                    }
+                }
+                free_distro(distro);
+                if(eof) {
+                    break;
+                }
+            }
+            if(fflush(stdout) == EOF) {
+                eof = true;
+            }
+        }
+
+        if(!eof) {
+            length -= end + 1 - buffer;
+            memmove(buffer, end + 1, length);
         }
-        distro_list = distro_list->next;
     }
 
-    return false;
+    if(unlikely(ferror(stdout))) {
+        parser.failures++;
+    } else if(unlikely(ferror(f))) {
+        fprintf(stderr, NAME ": Failed to read %s: %s\n", filename,
+                strerror(errno));
+        parser.failures++;
+    } else if(unlikely(!rows && parser.failures == 0)) {
+        fprintf(stderr, NAME ": No data found in file `%s'.\n", filename);
+        parser.failures++;
+    }
+    fclose(f);
+    free(buffer);
+    return parser.failures == 0;
 }
 
-static const distro_t *get_distro(const distro_elem_t *distro_list,
-                                  const date_t *date,
-                                  bool (*filter_cb)(const date_t*, const distro_t*),
-                                  const distro_t *(*select_cb)(const distro_elem_t*)) {
-    distro_elem_t *current;
-    distro_elem_t *filtered_list = NULL;
-    distro_elem_t *last = NULL;
-    const distro_t *selected;
+/* A piece of output of a parallel worker, allocated in its output arena. */
+typedef struct parallel_output_s {
+    struct parallel_output_s *next;
+    size_t length;
+    char data[];
+} parallel_output_t;
 
-    while(distro_list != NULL) {
-        if(filter_cb(date, distro_list->distro)) {
-            current = malloc(sizeof(distro_elem_t));
-            current->distro = distro_list->distro;
-            current->next = NULL;
-            if(last == NULL) {
-                filtered_list = current;
-            } else {
-                last->next = current;
+/* A piece of the data file for parallel_data() that ends after a newline
+ * (or at the end of the file) and the output of its matching rows.
+ */
+typedef struct {
+    const char *start;
+    size_t length;
+    parallel_output_t *output;
+    bool rows;
+} parallel_chunk_t;
+
+typedef struct {
+    parallel_chunk_t *chunks;
+    size_t count;
+    size_t next;
+    bool failed;
+    const char *filename;
+    const query_t *query;
+    const date_t *date;
+    arena_t *outputs;
+    size_t workers;
+} parallel_job_t;
+
+// Where the stream of a parallel worker appends its output.
+typedef struct {
+    arena_t *arena;
+    parallel_output_t **tail;
+} parallel_sink_t;
+
+static ssize_t parallel_write(void *cookie, const char *buffer, size_t size) {
+    parallel_sink_t *sink = cookie;
+    parallel_output_t *output;
+
+    output = arena_alloc(sink->arena, sizeof(parallel_output_t) + size);
+    output->next = NULL;
+    output->length = size;
+    memcpy(output->data, buffer, size);
+    *sink->tail = output;
+    sink->tail = &output->next;
+    return size;
+}
+
+/* Take chunks from the job until none are left. Every worker copies its
+ * chunk of the read-only mapping into its own arena (the tokenizer writes
+ * into the data and reads whole blocks beyond the end of the chunk) and allocates the rows there,
+ * so that the workers never share memory or wait for malloc(). The output
+ * goes through one buffered stream per worker into a second arena, which
+ * is kept until parallel_data() has printed it.
+ */
+static void *parallel_worker(void *arg) {
+    parallel_job_t *job = arg;
+    arena_t arena = {NULL};
+    arena_t *output = &job->outputs[__atomic_fetch_add(&job->workers, 1,
+                                                       __ATOMIC_RELAXED)];
+    row_parser_t parser = {job->filename, milestones, &arena, true, 0};
+    const cookie_io_functions_t functions = {NULL, parallel_write, NULL, NULL};
+    parallel_sink_t sink = {output, NULL};
+    parallel_chunk_t *chunk;
+    csv_reader_t reader;
+    distro_t *distro;
+    FILE *stream;
+    char *data;
+    char *field;
+    char separator;
+    size_t i;
+
+    stream = fopencookie(&sink, "w", functions);
+    setvbuf(stream, arena_alloc(output, BUFSIZ), _IOFBF, BUFSIZ);
+    while((i = __atomic_fetch_add(&job->next, 1, __ATOMIC_RELAXED)) < job->count &&
+          !__atomic_load_n(&job->failed, __ATOMIC_RELAXED)) {
+        chunk = &job->chunks[i];
+        data = arena_alloc(&arena, chunk->length + CSV_BLOCK);
+        memcpy(data, chunk->start, chunk->length);
+        memset(data + chunk->length, '\0', CSV_BLOCK);
+
+        sink.tail = &chunk->output;
+        csv_start(&reader, data, data + chunk->length);
+        while(parser.failures == 0 &&
+              (field = csv_field(&reader, &separator)) != NULL) {
+            distro = read_row(&reader, field, &separator, &parser, 0);
+            if(distro == NULL) {
+                continue;
             }
-            last = current;
+            chunk->rows = true;
+            if(parser.failures == 0 && matches(job->query->filter, job->date, distro)) {
+                job->query->print_cb(stream, distro, job->date,
+                                     job->query->date_index, job->query->just_days);
+            }
+        }
+        fflush(stream);
+        arena_reset(&arena);
+        if(parser.failures > 0) {
+            __atomic_store_n(&job->failed, true, __ATOMIC_RELAXED);
+        }
+    }
+    fclose(stream);
+    arena_free(&arena);
+    return NULL;
+}
+
+/* Answer a query that lists versions like stream_data() does, but let a
+ * pool of threads parse and filter the mapped data file in chunks of
+ * lines. The outputs of the chunks are printed in the order of the file
+ * once all chunks are done. Files below PARALLEL_THRESHOLD, files that
+ * cannot be mapped and files with errors are left to the serial path.
+ * Like stream_data(), a failure to write the output fails silently.
+ */
+maybe_unused static enum PARALLEL parallel_data(const char *filename,
+                                                const query_t *query,
+                                                const date_t *date) {
+    parallel_job_t job = {NULL, 0, 0, false, filename, query, date, NULL, 0};
+    const parallel_output_t *output;
+    enum PARALLEL result;
+    pthread_t *threads;
+    struct stat stat_buf;
+    const char *content;
+    const char *data;
+    const char *end;
+    const char *boundary;
+    size_t chunk_size;
+    size_t n_threads;
+    size_t started;
+    size_t i;
+    long online;
+    int fd;
+    bool rows = false;
+
+    online = PARALLEL_THREADS;
+    if(stat(filename, &stat_buf) != 0 || stat_buf.st_size < PARALLEL_THRESHOLD ||
+       online < 2) {
+        return PARALLEL_SERIAL;
+    }
+    fd = open(filename, O_RDONLY);
+    if(unlikely(fd < 0)) {
+        fprintf(stderr, NAME ": Failed to open %s: %s\n", filename,
+                strerror(errno));
+        return PARALLEL_FAILURE;
+    }
+    // The size of the mapping is the one of the file when it was mapped.
+    if(fstat(fd, &stat_buf) != 0 || stat_buf.st_size < PARALLEL_THRESHOLD ||
+       (content = mmap(NULL, stat_buf.st_size, PROT_READ, MAP_PRIVATE, fd, 0))
+           == MAP_FAILED) {
+        close(fd);
+        return PARALLEL_SERIAL;
+    }
+    close(fd);
+    end = content + stat_buf.st_size;
+    data = memchr(content, '\n', stat_buf.st_size);
+    if(data == NULL || strncmp(CSV_HEADER, content, strlen(CSV_HEADER)) != 0 ||
+       memchr(content, '\0', stat_buf.st_size) != NULL) {
+        munmap((void *)content, stat_buf.st_size);
+        return PARALLEL_SERIAL;
+    }
+    data++;
+
+    // A few chunks per thread, so that the threads finish at the same time.
+    n_threads = online;
+    chunk_size = (end - data) / (4 * n_threads) + 1;
+    job.chunks = calloc((end - data) / chunk_size + 1, sizeof(parallel_chunk_t));
+    while(data < end) {
+        boundary = end - data > (ptrdiff_t)chunk_size
+                   ? memchr(data + chunk_size, '\n', end - data - chunk_size) : NULL;
+        boundary = boundary ? boundary + 1 : end;
+        job.chunks[job.count].start = data;
+        job.chunks[job.count].length = boundary - data;
+        job.count++;
+        data = boundary;
+    }
+
+    if(n_threads > job.count) {
+        n_threads = job.count;
+    }
+    threads = malloc(n_threads * sizeof(pthread_t));
+    job.outputs = calloc(n_threads, sizeof(arena_t));
+    for(started = 1; started < n_threads; started++) {
+        if(pthread_create(&threads[started], NULL, parallel_worker, &job) != 0) {
+            break;
+        }
+    }
+    parallel_worker(&job);
+    for(i = 1; i < started; i++) {
+        pthread_join(threads[i], NULL);
+    }
+    free(threads);
+
+    for(i = 0; i < job.count; i++) {
+        rows = rows || job.chunks[i].rows;
+    }
+    result = PARALLEL_SERIAL;
+    if(!job.failed && rows) {
+        for(i = 0; i < job.count; i++) {
+            for(output = job.chunks[i].output; output != NULL; output = output->next) {
+                fwrite(output->data, 1, output->length, stdout);
+            }
+        }
+        fflush(stdout);
+        result = unlikely(ferror(stdout)) ? PARALLEL_FAILURE : PARALLEL_SUCCESS;
+    }
+    for(i = 0; i < n_threads; i++) {
+        arena_free(&job.outputs[i]);
+    }
+    free(job.outputs);
+    free(job.chunks);
+    munmap((void *)content, stat_buf.st_size);
+    return result;
+}
+
+static inline datekey_t date_to_key(const date_t *date) {
+    return date == NULL ? DATEKEY_ABSENT :
+           (datekey_t)(date->year << 9 | date->month << 5 | date->day);
+}
+
+static int compare_datekeys(const void *a, const void *b) {
+    const datekey_t x = *(const datekey_t *)a;
+    const datekey_t y = *(const datekey_t *)b;
+
+    return x < y ? -1 : x > y;
+}
+
+static void free_table(distro_table_t *table) {
+    int milestone_index;
+    size_t row;
+
+    if(table == NULL) {
+        return;
+    }
+    for(milestone_index = 0; milestone_index < (int)MILESTONE_COUNT;
+        milestone_index++) {
+        free(table->columns[milestone_index]);
+    }
+    free(table->versioned);
+#ifdef UBUNTU
+    free(table->lts);
+#endif
+    for(row = 0; row < table->n_names; row++) {
+        free(table->names[row].key);
+    }
+    free(table->names);
+    free(table->newest);
+    free(table->rows);
+    free(table);
+}
+
+static int compare_names(const void *a, const void *b) {
+    const name_t *name1 = a;
+    const name_t *name2 = b;
+    int result = strcmp(name1->key, name2->key);
+
+    if(result != 0) {
+        return result;
+    }
+    return name1->row < name2->row ? -1 : name1->row > name2->row;
+}
+
+static void add_name(distro_table_t *table, const char *name, size_t row) {
+    char *key;
+
+    if(*name == '\0') {
+        return;
+    }
+    key = strdup(name);
+    for(char *c = key; *c != '\0'; c++) {
+        *c = tolower((unsigned char)*c);
+    }
+    table->names[table->n_names].key = key;
+    table->names[table->n_names].row = row;
+    table->n_names++;
+}
+
+typedef struct {
+    datekey_t release;
+    datekey_t created;
+    size_t row;
+} newest_key_t;
+
+// Newest first; DATEKEY_ABSENT (not released yet) is the newest release.
+static int compare_newest(const void *a, const void *b) {
+    const newest_key_t *key1 = a;
+    const newest_key_t *key2 = b;
+
+    if(key1->release != key2->release) {
+        return key1->release > key2->release ? -1 : 1;
+    }
+    if(key1->created != key2->created) {
+        return key1->created > key2->created ? -1 : 1;
+    }
+    return key1->row > key2->row ? -1 : key1->row < key2->row;
+}
+
+static inline void newest_key(const distro_table_t *table, size_t row,
+                              newest_key_t *key) {
+    key->release = table->columns[MILESTONE_RELEASE][row];
+    key->created = table->columns[MILESTONE_CREATED][row];
+    key->row = row;
+}
+
+static inline void add_names(distro_table_t *table, const distro_t *distro,
+                             size_t row) {
+    add_name(table, distro->series, row);
+    add_name(table, distro->codename, row);
+    add_name(table, distro->version, row);
+}
+
+/* New table of distro_list with the columns and bit sets filled in, but
+ * without names and newest (see build_table()).
+ */
+static distro_table_t *table_columns(const distro_elem_t *distro_list) {
+    const distro_elem_t *current;
+    distro_table_t *table;
+    size_t padded;
+    size_t row;
+    int milestone_index;
+
+    table = calloc(1, sizeof(distro_table_t));
+    for(current = distro_list; current != NULL; current = current->next) {
+        table->count++;
+    }
+    table->words = (table->count + ROWS_PER_WORD - 1) / ROWS_PER_WORD;
+    padded = table->words * ROWS_PER_WORD;
+
+    table->rows = malloc(table->count * sizeof(distro_t *));
+    for(milestone_index = 0; milestone_index < (int)MILESTONE_COUNT;
+        milestone_index++) {
+        table->columns[milestone_index] = malloc(padded * sizeof(datekey_t));
+    }
+    table->versioned = calloc(table->words, sizeof(uint64_t));
+#ifdef UBUNTU
+    table->lts = calloc(table->words, sizeof(uint64_t));
+#endif
+    table->names = malloc(3 * table->count * sizeof(name_t));
+
+    for(row = 0, current = distro_list; row < padded; row++) {
+        const distro_t *distro = current ? current->distro : NULL;
+
+        for(milestone_index = 0; milestone_index < (int)MILESTONE_COUNT;
+            milestone_index++) {
+            table->columns[milestone_index][row] =
+                distro ? date_to_key(distro->milestones[milestone_index])
+                       : DATEKEY_ABSENT;
+        }
+        if(distro == NULL) {
+            continue;
+        }
+        table->rows[row] = distro;
+        if(*distro->version != '\0') {
+            table->versioned[row / ROWS_PER_WORD] |= (uint64_t)1 << (row % ROWS_PER_WORD);
+        }
+#ifdef UBUNTU
+        if(strstr(distro->version, "LTS") != NULL) {
+            table->lts[row / ROWS_PER_WORD] |= (uint64_t)1 << (row % ROWS_PER_WORD);
+        }
+#endif
+        current = current->next;
+    }
+    return table;
+}
+
+static distro_table_t *build_table(const distro_elem_t *distro_list) {
+    distro_table_t *table = table_columns(distro_list);
+    size_t row;
+
+    for(row = 0; row < table->count; row++) {
+        add_names(table, table->rows[row], row);
+    }
+    qsort(table->names, table->n_names, sizeof(name_t), compare_names);
+    return table;
+}
+
+/* The newest order of table. Only --newest-first and --shared need it, so
+ * it is sorted on first use. Readers of the same snapshot may sort it at
+ * the same time; the first one to publish its order wins.
+ */
+static const size_t *table_newest(const distro_table_t *table) {
+    size_t *newest = __atomic_load_n(&table->newest, __ATOMIC_ACQUIRE);
+    size_t *published = NULL;
+    newest_key_t *keys;
+    size_t row;
+
+    if(newest != NULL) {
+        return newest;
+    }
+    keys = malloc((table->count + 1) * sizeof(newest_key_t));
+    for(row = 0; row < table->count; row++) {
+        newest_key(table, row, &keys[row]);
+    }
+    qsort(keys, table->count, sizeof(newest_key_t), compare_newest);
+    newest = malloc((table->count + 1) * sizeof(size_t));
+    for(row = 0; row < table->count; row++) {
+        newest[row] = keys[row].row;
+    }
+    free(keys);
+    if(!__atomic_compare_exchange_n(&((distro_table_t *)table)->newest, &published,
+                                    newest, false, __ATOMIC_ACQ_REL,
+                                    __ATOMIC_ACQUIRE)) {
+        free(newest);
+        newest = published;
+    }
+    return newest;
+}
+
+/* Index of the first name in table that is not less than prefix. */
+static size_t lower_bound_name(const distro_table_t *table, const char *prefix) {
+    size_t low = 0;
+    size_t high = table->n_names;
+    size_t middle;
+
+    while(low < high) {
+        middle = low + (high - low) / 2;
+        if(strcmp(table->names[middle].key, prefix) < 0) {
+            low = middle + 1;
+        } else {
+            high = middle;
+        }
+    }
+    return low;
+}
+
+/* Print the series of every version whose series, codename, or version
+ * starts with prefix (ignoring case), in the order of the data file.
+ */
+maybe_unused static void print_completions(FILE *stream, const distro_table_t *table,
+                                           const char *prefix) {
+    bool *found = calloc(table->count, sizeof(bool));
+    char *key = strdup(prefix);
+    size_t length = strlen(prefix);
+    size_t i;
+
+    for(char *c = key; *c != '\0'; c++) {
+        *c = tolower((unsigned char)*c);
+    }
+    for(i = lower_bound_name(table, key);
+        i < table->n_names && strncmp(table->names[i].key, key, length) == 0; i++) {
+        found[table->names[i].row] = true;
+    }
+    for(i = 0; i < table->count; i++) {
+        if(found[i]) {
+            fprintf(stream, "%s\n", table->rows[i]->series);
+        }
+    }
+    free(key);
+    free(found);
+}
+
+/* Levenshtein distance of a and b (of length_b), or limit + 1 if it exceeds
+ * limit. scratch has room for two rows of length_b + 1 entries.
+ */
+static size_t edit_distance(const char *a, size_t length_a, const char *b,
+                            size_t length_b, size_t limit, size_t *scratch) {
+    size_t *previous = scratch;
+    size_t *current = scratch + length_b + 1;
+    size_t *swap;
+    size_t minimum = 0;
+    size_t cost;
+    size_t i;
+    size_t j;
+
+    for(j = 0; j <= length_b; j++) {
+        previous[j] = j;
+    }
+    for(i = 1; i <= length_a; i++) {
+        current[0] = i;
+        minimum = i;
+        for(j = 1; j <= length_b; j++) {
+            cost = previous[j - 1] + (a[i - 1] != b[j - 1]);
+            if(previous[j] + 1 < cost) {
+                cost = previous[j] + 1;
+            }
+            if(current[j - 1] + 1 < cost) {
+                cost = current[j - 1] + 1;
+            }
+            current[j] = cost;
+            if(cost < minimum) {
+                minimum = cost;
+            }
+        }
+        swap = previous;
+        previous = current;
+        current = swap;
+        if(minimum > limit) {
+            return limit + 1;
+        }
+    }
+    return previous[length_b] > limit ? limit + 1 : previous[length_b];
+}
+
+/* The series whose series or codename is closest to the unknown name, or
+ * NULL if none is close enough to be a typo. Names whose length differs by
+ * more than the limit cannot be close enough and are skipped.
+ */
+static const char *suggest_series(const distro_table_t *table, const char *name) {
+    size_t length = strlen(name);
+    size_t limit = length < 5 ? 1 : 2;
+    size_t best = limit + 1;
+    size_t distance;
+    size_t key_length;
+    size_t *scratch;
+    const char *suggestion = NULL;
+    size_t i;
+
+    scratch = malloc(2 * (length + limit + 1) * sizeof(size_t));
+    for(i = 0; i < table->n_names && best > 0; i++) {
+        key_length = strlen(table->names[i].key);
+        if(key_length + limit < length || key_length > length + limit) {
+            continue;
+        }
+        distance = edit_distance(name, length, table->names[i].key, key_length,
+                                 limit, scratch);
+        if(distance < best) {
+            best = distance;
+            suggestion = table->rows[table->names[i].row]->series;
+        }
+    }
+    free(scratch);
+    return suggestion;
+}
+
+static void snapshot_release(snapshot_t *snapshot) {
+    if(snapshot == NULL ||
+       __atomic_sub_fetch(&snapshot->references, 1, __ATOMIC_ACQ_REL) != 0) {
+        return;
+    }
+    if(snapshot->mapping) {
+        // See snapshot_attach(): the list and its rows are two arrays.
+        free(snapshot->list->distro);
+        free(snapshot->list);
+        free(snapshot->table->rows);
+        free(snapshot->table->names);
+        free(snapshot->table);
+        munmap(snapshot->mapping, snapshot->mapping_size);
+    } else {
+        free_table(snapshot->table);
+        free_data(snapshot->list, &snapshot->content);
+    }
+    free(snapshot->lines);
+    free(snapshot);
+}
+
+/* New snapshot of distro_list and its table that holds one reference. */
+static snapshot_t *snapshot_wrap(distro_elem_t *distro_list, char *content,
+                                 distro_table_t *table) {
+    snapshot_t *snapshot;
+
+    snapshot = malloc(sizeof(snapshot_t));
+    snapshot->list = distro_list;
+    snapshot->content = content;
+    snapshot->table = table;
+    snapshot->references = 1;
+    snapshot->mapping = NULL;
+    snapshot->mapping_size = 0;
+    snapshot->lines = NULL;
+    return snapshot;
+}
+
+/* New snapshot of the parsed distro_list that holds one reference. */
+static inline snapshot_t *snapshot_new(distro_elem_t *distro_list, char *content) {
+    return snapshot_wrap(distro_list, content, build_table(distro_list));
+}
+
+/* Read filename into a new snapshot that holds one reference. */
+static snapshot_t *snapshot_load(const char *filename) {
+    distro_elem_t *distro_list;
+    char *content;
+
+    distro_list = read_data(filename, &content);
+    if(unlikely(distro_list == NULL)) {
+        return NULL;
+    }
+    return snapshot_new(distro_list, content);
+}
+
+/* Take a reference to the snapshot that is currently published in store
+ * (or return NULL if there is none). The caller has to release it with
+ * snapshot_release(). This never waits for a publisher: it only retries if
+ * a new snapshot was published while it registered itself.
+ */
+maybe_unused static snapshot_t *snapshot_acquire(snapshot_store_t *store) {
+    snapshot_t *snapshot;
+    unsigned long epoch;
+
+    for(;;) {
+        epoch = __atomic_load_n(&store->epoch, __ATOMIC_SEQ_CST);
+        __atomic_add_fetch(&store->readers[epoch & 1], 1, __ATOMIC_SEQ_CST);
+        if(likely(__atomic_load_n(&store->epoch, __ATOMIC_SEQ_CST) == epoch)) {
+            break;
+        }
+        __atomic_sub_fetch(&store->readers[epoch & 1], 1, __ATOMIC_SEQ_CST);
+    }
+
+    snapshot = __atomic_load_n(&store->current, __ATOMIC_SEQ_CST);
+    if(snapshot != NULL) {
+        __atomic_add_fetch(&snapshot->references, 1, __ATOMIC_RELAXED);
+    }
+    __atomic_sub_fetch(&store->readers[epoch & 1], 1, __ATOMIC_SEQ_CST);
+    return snapshot;
+}
+
+/* Replace the published snapshot of store by snapshot (which may be NULL)
+ * and take over its reference. The replaced snapshot is released once no
+ * reader can pick it up any more; readers that already hold it keep it
+ * alive until they release it.
+ */
+static void snapshot_publish(snapshot_store_t *store, snapshot_t *snapshot) {
+    snapshot_t *old;
+    unsigned long epoch;
+
+    while(__atomic_exchange_n(&store->publishing, true, __ATOMIC_ACQUIRE)) {
+        sched_yield();
+    }
+    old = __atomic_exchange_n(&store->current, snapshot, __ATOMIC_SEQ_CST);
+    epoch = __atomic_fetch_add(&store->epoch, 1, __ATOMIC_SEQ_CST);
+    while(__atomic_load_n(&store->readers[epoch & 1], __ATOMIC_SEQ_CST) != 0) {
+        sched_yield();
+    }
+    __atomic_store_n(&store->publishing, false, __ATOMIC_RELEASE);
+    snapshot_release(old);
+}
+
+/* Return a bit set of the ROWS_PER_WORD dates in column that are reached at
+ * key. Absent dates count as reached if absent_reached is set.
+ */
+vectorized static uint64_t column_reached(const datekey_t *column, datekey_t key,
+                                          bool absent_reached) {
+    uint64_t word = 0;
+    int i;
+
+    for(i = 0; i < ROWS_PER_WORD; i++) {
+        word |= (uint64_t)(column[i] <= key ||
+                           (absent_reached && column[i] == DATEKEY_ABSENT)) << i;
+    }
+    return word;
+}
+
+// Column counterparts of the REACHED() and PASSED() rules of row_predicates()
+static always_inline uint64_t table_predicate(const distro_table_t *table,
+                                              int predicate, datekey_t key,
+                                              size_t word) {
+    const size_t offset = word * ROWS_PER_WORD;
+
+    switch(predicate) {
+        case PREDICATE_CREATED:
+            return column_reached(table->columns[MILESTONE_CREATED] + offset, key, false);
+        case PREDICATE_RELEASED:
+            return table->versioned[word] &
+                   column_reached(table->columns[MILESTONE_RELEASE] + offset, key, false);
+        case PREDICATE_EOL:
+            return column_reached(table->columns[MILESTONE_EOL] + offset, key, false)
+#ifdef UBUNTU
+                   & column_reached(table->columns[MILESTONE_EOL_SERVER] + offset, key, true)
+#endif
+            ;
+#ifdef DEBIAN
+        case PREDICATE_EOL_LTS:
+            return column_reached(table->columns[MILESTONE_EOL_LTS] + offset, key, true);
+        case PREDICATE_EOL_ELTS:
+            return column_reached(table->columns[MILESTONE_EOL_ELTS] + offset, key, true);
+#endif
+#ifdef UBUNTU
+        case PREDICATE_EOL_ESM:
+            return column_reached(table->columns[MILESTONE_EOL] + offset, key, false) &
+                   column_reached(table->columns[MILESTONE_EOL_ESM] + offset, key, true);
+        case PREDICATE_LTS:
+            return table->lts[word];
+#endif
+        case PREDICATE_VERSIONED:
+            return table->versioned[word];
+    }
+    assert(false);
+    return 0;
+}
+
+// Bit mask of the rows in word that actually exist
+static inline uint64_t table_rows(const distro_table_t *table, size_t word) {
+    size_t remaining = table->count - word * ROWS_PER_WORD;
+
+    return remaining >= ROWS_PER_WORD ? ~(uint64_t)0 : ((uint64_t)1 << remaining) - 1;
+}
+
+static always_inline uint64_t table_filter(const distro_table_t *table,
+                                           const filter_t *filter, datekey_t key,
+                                           size_t word) {
+    uint64_t matched = table_rows(table, word);
+    int predicate;
+
+    for(predicate = 0; predicate < (int)PREDICATE_COUNT && matched; predicate++) {
+        if(filter->require & (1U << predicate)) {
+            matched &= table_predicate(table, predicate, key, word);
+        } else if(filter->exclude & (1U << predicate)) {
+            matched &= ~table_predicate(table, predicate, key, word);
+        }
+    }
+    return matched;
+}
+
+// Generic version of filter_data() for any filter and print callback
+static bool filter_rows(FILE *stream, const distro_table_t *table,
+                        const date_t *date, int date_index, int just_days,
+                        const filter_t *filter,
+                        bool (*print_cb)(FILE*, const distro_t*, const date_t*, int, int)) {
+    const datekey_t key = date_to_key(date);
+    size_t word;
+    uint64_t matched;
+
+    for(word = 0; word < table->words; word++) {
+        matched = table_filter(table, filter, key, word);
+        while(matched) {
+            if(!print_cb(stream, table->rows[word * ROWS_PER_WORD + lowest_bit(matched)],
+                         date, date_index, just_days)) {
+                return false;
+            }
+            matched &= matched - 1;
+        }
+    }
+
+    return true;
+}
+
+// Specialized query kernels
+
+/* The kernels below are instantiated from one inlined template per kind
+ * with constant arguments, so that the compiler folds the filter masks
+ * into the predicate evaluation and resolves the output format and the
+ * days mode before the loop. The lists of instances are X-macros:
+ * KERNEL_FILTERS(X) calls X(name) for every filter_<name> that lists
+ * versions and KERNEL_SELECTORS(X) calls X(filter, selector) for every
+ * combination of a filter with a select callback that an option uses.
+ */
+#ifdef DEBIAN
+#define KERNEL_FILTERS(X) X(all) X(supported) X(unsupported) \
+                          X(lts_supported) X(elts_supported)
+#define KERNEL_SELECTORS(X) X(devel, first) X(testing, latest_created) \
+                            X(stable, latest_release) X(oldstable, oldstable)
+#endif
+#ifdef UBUNTU
+#define KERNEL_FILTERS(X) X(all) X(supported) X(unsupported) X(esm_supported)
+#define KERNEL_SELECTORS(X) X(devel, latest_created) X(stable, latest_release) \
+                            X(lts, latest_release)
+#endif
+
+#define KERNEL_PRINTERS(X, filter) X(filter, codename, CODENAME) \
+                                   X(filter, fullname, FULLNAME) \
+                                   X(filter, release, RELEASE)
+
+static always_inline void kernel_print_name(FILE *stream, const distro_t *distro,
+                                            enum KERNEL_PRINT print) {
+    switch(print) {
+        case KERNEL_CODENAME:
+            fputs(distro->series, stream);
+            break;
+        case KERNEL_FULLNAME:
+            fprintf(stream, DISTRO_NAME " %s \"%s\"", distro->version, distro->codename);
+            break;
+        case KERNEL_RELEASE:
+            fputs(unlikely(*distro->version == '\0') ? distro->series : distro->version,
+                  stream);
+            break;
+    }
+}
+
+/* Same output as filter_rows() with print_codename(), print_fullname(), or
+ * print_release(). The seconds of date are only computed once.
+ */
+static always_inline bool list_kernel(FILE *stream, const distro_table_t *table,
+                                      const date_t *date, int date_index,
+                                      const filter_t *filter,
+                                      enum KERNEL_PRINT print,
+                                      enum KERNEL_DAYS days_mode) {
+    const datekey_t key = date_to_key(date);
+    const time_t date_secs = days_mode == KERNEL_PLAIN ? 0 : date_to_secs(date);
+    const distro_t *distro;
+    const date_t *milestone;
+    size_t word;
+    uint64_t matched;
+    ssize_t days;
+
+    for(word = 0; word < table->words; word++) {
+        matched = table_filter(table, filter, key, word);
+        while(matched) {
+            distro = table->rows[word * ROWS_PER_WORD + lowest_bit(matched)];
+            matched &= matched - 1;
+            if(days_mode != KERNEL_JUST_DAYS) {
+                kernel_print_name(stream, distro, print);
+            }
+            if(days_mode == KERNEL_PLAIN) {
+                putc('\n', stream);
+            } else {
+                if(days_mode == KERNEL_DAYS) {
+                    putc(' ', stream);
+                }
+                milestone = distro->milestones[date_index];
+                if(milestone == NULL) {
+                    fputs(UNKNOWN_DAYS "\n", stream);
+                } else {
+                    if(date_ge(date, milestone)) {
+                        days = -(ssize_t)secs_diff(date_secs, date_to_secs(milestone));
+                    } else {
+                        days = secs_diff(date_to_secs(milestone), date_secs);
+                    }
+                    fprintf(stream, "%zd\n", days);
+                }
+            }
+            // Stop writing as soon as the reader is gone (EPIPE).
+            if(unlikely(ferror(stream))) {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+typedef bool (*list_kernel_t)(FILE*, const distro_table_t*, const date_t*, int);
+
+#define DEFINE_LIST_KERNEL(filter, printer, PRINT) \
+    static bool list_##filter##_##printer##_plain( \
+            FILE *stream, const distro_table_t *table, const date_t *date, \
+            int date_index) { \
+        return list_kernel(stream, table, date, date_index, &filter_##filter, \
+                           KERNEL_##PRINT, KERNEL_PLAIN); \
+    } \
+    static bool list_##filter##_##printer##_days( \
+            FILE *stream, const distro_table_t *table, const date_t *date, \
+            int date_index) { \
+        return list_kernel(stream, table, date, date_index, &filter_##filter, \
+                           KERNEL_##PRINT, KERNEL_DAYS); \
+    } \
+    static bool list_##filter##_##printer##_just_days( \
+            FILE *stream, const distro_table_t *table, const date_t *date, \
+            int date_index) { \
+        return list_kernel(stream, table, date, date_index, &filter_##filter, \
+                           KERNEL_##PRINT, KERNEL_JUST_DAYS); \
+    }
+#define DEFINE_LIST_KERNELS(filter) KERNEL_PRINTERS(DEFINE_LIST_KERNEL, filter)
+KERNEL_FILTERS(DEFINE_LIST_KERNELS)
+
+typedef struct {
+    const filter_t *filter;
+    bool (*print_cb)(FILE*, const distro_t*, const date_t*, int, int);
+    const char *name;
+    list_kernel_t kernels[KERNEL_DAYS_COUNT];
+} list_kernel_entry_t;
+
+#define LIST_KERNEL_ENTRY(filter, printer, PRINT) \
+    {&filter_##filter, print_##printer, #filter "/" #printer, \
+     {list_##filter##_##printer##_plain, list_##filter##_##printer##_days, \
+      list_##filter##_##printer##_just_days}},
+#define LIST_KERNEL_ENTRIES(filter) KERNEL_PRINTERS(LIST_KERNEL_ENTRY, filter)
+
+static const list_kernel_entry_t list_kernels[] = {
+    KERNEL_FILTERS(LIST_KERNEL_ENTRIES)
+};
+
+#define LIST_KERNEL_COUNT (sizeof(list_kernels) / sizeof(list_kernels[0]))
+
+static inline enum KERNEL_DAYS kernel_days_mode(int date_index, int just_days) {
+    return date_index < 0 ? KERNEL_PLAIN : just_days ? KERNEL_JUST_DAYS : KERNEL_DAYS;
+}
+
+// The kernel for filter and print_cb or NULL if there is none
+static list_kernel_t find_list_kernel(const filter_t *filter,
+                                      bool (*print_cb)(FILE*, const distro_t*,
+                                                       const date_t*, int, int),
+                                      enum KERNEL_DAYS days_mode) {
+    size_t i;
+
+    for(i = 0; i < LIST_KERNEL_COUNT; i++) {
+        if(list_kernels[i].filter == filter && list_kernels[i].print_cb == print_cb) {
+            return list_kernels[i].kernels[days_mode];
+        }
+    }
+    return NULL;
+}
+
+static bool filter_data(FILE *stream, const distro_table_t *table,
+                        const date_t *date, int date_index, int just_days,
+                        const filter_t *filter,
+                        bool (*print_cb)(FILE*, const distro_t*, const date_t*, int, int)) {
+    list_kernel_t kernel = find_list_kernel(filter, print_cb,
+                                            kernel_days_mode(date_index, just_days));
+
+    if(kernel) {
+        return kernel(stream, table, date, date_index);
+    }
+    return filter_rows(stream, table, date, date_index, just_days, filter, print_cb);
+}
+
+// Result cursor
+
+static void cursor_start(cursor_t *cursor, const distro_table_t *table,
+                         const filter_t *filter, const date_t *date,
+                         enum ORDER order) {
+    cursor->table = table;
+    cursor->filter = filter;
+    cursor->key = date_to_key(date);
+    cursor->order = order;
+    cursor->position = order == ORDER_REVERSE ? table->words : 0;
+    cursor->matched = 0;
+    cursor->words = NULL;
+    cursor->evaluated = NULL;
+    cursor->newest = NULL;
+    if(order == ORDER_NEWEST) {
+        cursor->newest = table_newest(table);
+        cursor->words = malloc(table->words * sizeof(uint64_t));
+        cursor->evaluated = calloc(table->words, sizeof(bool));
+    }
+}
+
+/* Return the next matching row in the order of the cursor or NULL if there
+ * are no more.
+ */
+static const distro_t *cursor_next(cursor_t *cursor) {
+    const distro_table_t *table = cursor->table;
+    unsigned int bit;
+    size_t row;
+    size_t word;
+
+    switch(cursor->order) {
+        case ORDER_FILE:
+            while(cursor->matched == 0) {
+                if(cursor->position == table->words) {
+                    return NULL;
+                }
+                cursor->matched = table_filter(table, cursor->filter, cursor->key,
+                                               cursor->position++);
+            }
+            bit = lowest_bit(cursor->matched);
+            cursor->matched &= cursor->matched - 1;
+            return table->rows[(cursor->position - 1) * ROWS_PER_WORD + bit];
+
+        case ORDER_REVERSE:
+            while(cursor->matched == 0) {
+                if(cursor->position == 0) {
+                    return NULL;
+                }
+                cursor->matched = table_filter(table, cursor->filter, cursor->key,
+                                               --cursor->position);
+            }
+            bit = highest_bit(cursor->matched);
+            cursor->matched &= ~((uint64_t)1 << bit);
+            return table->rows[cursor->position * ROWS_PER_WORD + bit];
+
+        case ORDER_NEWEST:
+            while(cursor->position < table->count) {
+                row = cursor->newest[cursor->position++];
+                word = row / ROWS_PER_WORD;
+                if(!cursor->evaluated[word]) {
+                    cursor->words[word] = table_filter(table, cursor->filter,
+                                                       cursor->key, word);
+                    cursor->evaluated[word] = true;
+                }
+                if(cursor->words[word] & ((uint64_t)1 << (row % ROWS_PER_WORD))) {
+                    return table->rows[row];
+                }
+            }
+            return NULL;
+    }
+    return NULL;
+}
+
+static void cursor_end(cursor_t *cursor) {
+    free(cursor->words);
+    free(cursor->evaluated);
+}
+
+/* Print the rows that match the filter of query in the order of the query,
+ * but at most query->limit rows (if it is not 0).
+ */
+static bool list_rows(FILE *stream, const distro_table_t *table,
+                      const date_t *date, const query_t *query) {
+    cursor_t cursor;
+    const distro_t *distro;
+    size_t printed = 0;
+    bool success = true;
+
+    cursor_start(&cursor, table, query->filter, date, query->order);
+    while((query->limit == 0 || printed < query->limit) &&
+          (distro = cursor_next(&cursor)) != NULL) {
+        if(!query->print_cb(stream, distro, date, query->date_index,
+                            query->just_days)) {
+            success = false;
+            break;
+        }
+        printed++;
+    }
+    cursor_end(&cursor);
+    return success;
+}
+
+// Compiling and evaluating --query expressions
+
+typedef struct {
+    const char *pos;
+    expr_t *expr;
+    char error[128];
+} expr_parser_t;
+
+static bool parse_or(expr_parser_t *parser);
+
+static void free_expr(expr_t *expr) {
+    size_t i;
+
+    if(expr == NULL) {
+        return;
+    }
+    for(i = 0; i < expr->length; i++) {
+        free(expr->ops[i].text);
+    }
+    free(expr->ops);
+    free(expr->source);
+    free(expr);
+}
+
+static void emit(expr_parser_t *parser, enum EXPR_OP op, int predicate,
+                 datekey_t key, char *text) {
+    expr_t *expr = parser->expr;
+    expr_op_t *step;
+
+    expr->ops = realloc(expr->ops, (expr->length + 1) * sizeof(expr_op_t));
+    step = &expr->ops[expr->length++];
+    step->op = op;
+    step->predicate = predicate;
+    step->key = key;
+    step->text = text;
+}
+
+static bool parse_error(expr_parser_t *parser, const char *format,
+                        const char *token) {
+    snprintf(parser->error, sizeof(parser->error), format, token);
+    return false;
+}
+
+static inline void skip_spaces(expr_parser_t *parser) {
+    parser->pos += strspn(parser->pos, " \t");
+}
+
+static char *parse_word(expr_parser_t *parser, const char *accept) {
+    size_t length = strspn(parser->pos, accept);
+    char *word = strndup(parser->pos, length);
+
+    parser->pos += length;
+    return word;
+}
+
+static bool parse_atom(expr_parser_t *parser) {
+    char *name;
+    char *value;
+    date_t date;
+    datekey_t key = DATEKEY_ABSENT;
+    int predicate;
+
+    skip_spaces(parser);
+    if(*parser->pos == '(') {
+        parser->pos++;
+        if(!parse_or(parser)) {
+            return false;
+        }
+        skip_spaces(parser);
+        if(*parser->pos != ')') {
+            return parse_error(parser, "missing `)'%s", "");
+        }
+        parser->pos++;
+        return true;
+    }
+    if(*parser->pos == '!') {
+        parser->pos++;
+        if(!parse_atom(parser)) {
+            return false;
+        }
+        emit(parser, EXPR_NOT, -1, DATEKEY_ABSENT, NULL);
+        return true;
+    }
+
+    name = parse_word(parser, "abcdefghijklmnopqrstuvwxyz_");
+    if(*name == '\0') {
+        free(name);
+        if(*parser->pos == '\0') {
+            return parse_error(parser, "unexpected end of query%s", "");
+        }
+        return parse_error(parser, "unexpected `%.1s'", parser->pos);
+    }
+    if(*parser->pos == '=') {
+        parser->pos++;
+        value = parse_word(parser, "abcdefghijklmnopqrstuvwxyz0123456789.");
+        if(*value == '\0') {
+            free(value);
+            parse_error(parser, "missing value for `%s'", name);
+            free(name);
+            return false;
+        }
+        if(strcmp(name, "series") == 0) {
+            emit(parser, EXPR_SERIES, -1, DATEKEY_ABSENT, value);
+        } else if(strcmp(name, "version") == 0) {
+            emit(parser, EXPR_VERSION, -1, DATEKEY_ABSENT, value);
+        } else {
+            free(value);
+            parse_error(parser, "unknown match `%s='", name);
+            free(name);
+            return false;
+        }
+        free(name);
+        return true;
+    }
+
+    for(predicate = 0; predicate < (int)PREDICATE_COUNT; predicate++) {
+        if(strcmp(name, predicates[predicate]) == 0) {
+            break;
+        }
+    }
+    if(predicate == PREDICATE_COUNT) {
+        parse_error(parser, "unknown predicate `%s'", name);
+        free(name);
+        return false;
+    }
+    free(name);
+    if(*parser->pos == '@') {
+        parser->pos++;
+        value = parse_word(parser, "0123456789-");
+        if(!parse_date(value, &date)) {
+            parse_error(parser, "invalid date `%s'", value);
+            free(value);
+            return false;
+        }
+        free(value);
+        key = date_to_key(&date);
+    }
+    emit(parser, EXPR_PREDICATE, predicate, key, NULL);
+    return true;
+}
+
+static bool parse_and(expr_parser_t *parser) {
+    if(!parse_atom(parser)) {
+        return false;
+    }
+    skip_spaces(parser);
+    while(*parser->pos == '&') {
+        parser->pos++;
+        if(!parse_atom(parser)) {
+            return false;
+        }
+        emit(parser, EXPR_AND, -1, DATEKEY_ABSENT, NULL);
+        skip_spaces(parser);
+    }
+    return true;
+}
+
+static bool parse_or(expr_parser_t *parser) {
+    if(!parse_and(parser)) {
+        return false;
+    }
+    skip_spaces(parser);
+    while(*parser->pos == '|') {
+        parser->pos++;
+        if(!parse_and(parser)) {
+            return false;
+        }
+        emit(parser, EXPR_OR, -1, DATEKEY_ABSENT, NULL);
+        skip_spaces(parser);
+    }
+    return true;
+}
+
+// Compile a --query expression. Returns NULL and prints an error on failure.
+maybe_unused static expr_t *compile_expr(const char *string) {
+    expr_parser_t parser;
+
+    parser.pos = string;
+    parser.expr = calloc(1, sizeof(expr_t));
+    parser.expr->source = strdup(string);
+    if(parse_or(&parser)) {
+        skip_spaces(&parser);
+        if(*parser.pos == '\0') {
+            return parser.expr;
+        }
+        parse_error(&parser, "unexpected `%.1s'", parser.pos);
+    }
+    fprintf(stderr, NAME ": invalid query `%s': %s\n", string, parser.error);
+    free_expr(parser.expr);
+    return NULL;
+}
+
+static uint64_t table_match_text(const distro_table_t *table, size_t word,
+                                 enum EXPR_OP op, const char *text) {
+    const size_t offset = word * ROWS_PER_WORD;
+    const distro_t *distro;
+    uint64_t matched = 0;
+    size_t length = strlen(text);
+    size_t i;
+
+    for(i = 0; i < ROWS_PER_WORD && offset + i < table->count; i++) {
+        distro = table->rows[offset + i];
+        if(op == EXPR_SERIES ? strcmp(distro->series, text) == 0 :
+           (strncmp(distro->version, text, length) == 0 &&
+            (distro->version[length] == '\0' || distro->version[length] == ' '))) {
+            matched |= (uint64_t)1 << i;
+        }
+    }
+    return matched;
+}
+
+// Evaluate a compiled expression for the rows of one word.
+static uint64_t table_expr(const distro_table_t *table, const expr_t *expr,
+                           datekey_t key, size_t word, uint64_t *stack) {
+    size_t depth = 0;
+    size_t i;
+
+    for(i = 0; i < expr->length; i++) {
+        const expr_op_t *step = &expr->ops[i];
+
+        switch(step->op) {
+            case EXPR_PREDICATE:
+                stack[depth++] = table_predicate(table, step->predicate,
+                                                 step->key == DATEKEY_ABSENT ? key : step->key,
+                                                 word);
+                break;
+            case EXPR_SERIES:
+            case EXPR_VERSION:
+                stack[depth++] = table_match_text(table, word, step->op, step->text);
+                break;
+            case EXPR_NOT:
+                stack[depth - 1] = ~stack[depth - 1];
+                break;
+            case EXPR_AND:
+                depth--;
+                stack[depth - 1] &= stack[depth];
+                break;
+            case EXPR_OR:
+                depth--;
+                stack[depth - 1] |= stack[depth];
+                break;
+        }
+    }
+    assert(depth == 1);
+    return stack[0] & table_rows(table, word);
+}
+
+static bool query_data(FILE *stream, const distro_table_t *table,
+                       const date_t *date, int date_index, int just_days,
+                       const expr_t *expr,
+                       bool (*print_cb)(FILE*, const distro_t*, const date_t*, int, int)) {
+    const datekey_t key = date_to_key(date);
+    uint64_t *stack = malloc(expr->length * sizeof(uint64_t));
+    bool success = true;
+    size_t word;
+    uint64_t matched;
+
+    for(word = 0; word < table->words && success; word++) {
+        matched = table_expr(table, expr, key, word, stack);
+        while(matched && success) {
+            success = print_cb(stream, table->rows[word * ROWS_PER_WORD + lowest_bit(matched)],
+                               date, date_index, just_days);
+            matched &= matched - 1;
+        }
+    }
+
+    free(stack);
+    return success;
+}
+
+/* Apply select_cb to the distributions for which match_cb holds at date. */
+static const distro_t *select_matching(const distro_elem_t *distro_list,
+                                       const date_t *date,
+                                       bool (*match_cb)(const void*, const date_t*,
+                                                        const distro_t*),
+                                       const void *match_arg,
+                                       const distro_t *(*select_cb)(const distro_elem_t*)) {
+    distro_elem_t *current;
+    distro_elem_t *filtered_list = NULL;
+    distro_elem_t *last = NULL;
+    const distro_t *selected;
+
+    while(distro_list != NULL) {
+        if(match_cb(match_arg, date, distro_list->distro)) {
+            current = malloc(sizeof(distro_elem_t));
+            current->distro = distro_list->distro;
+            current->next = NULL;
+            if(last == NULL) {
+                filtered_list = current;
+            } else {
+                last->next = current;
+            }
+            last = current;
+        }
+        distro_list = distro_list->next;
+    }
+
+    if(filtered_list == NULL) {
+        selected = NULL;
+    } else {
+        selected = select_cb(filtered_list);
+    }
+
+    while(filtered_list != NULL) {
+        current = filtered_list->next;
+        free(filtered_list);
+        filtered_list = current;
+    }
+
+    return selected;
+}
+
+static bool match_filter(const void *filter, const date_t *date,
+                         const distro_t *distro) {
+    return matches(filter, date, distro);
+}
+
+static const distro_t *get_distro(const distro_elem_t *distro_list,
+                                  const date_t *date, const filter_t *filter,
+                                  const distro_t *(*select_cb)(const distro_elem_t*)) {
+    return select_matching(distro_list, date, match_filter, filter, select_cb);
+}
+
+/* Same result as get_distro() with select_first(), select_latest_created(),
+ * select_latest_release(), or select_oldstable(), computed on the table.
+ * Later rows win ties like in the select callbacks.
+ */
+static always_inline const distro_t *select_kernel(const distro_table_t *table,
+                                                   const date_t *date,
+                                                   const filter_t *filter,
+                                                   enum KERNEL_SELECT selector) {
+    const datekey_t key = date_to_key(date);
+    const datekey_t *column = table->columns[selector == KERNEL_LATEST_CREATED ?
+                                             MILESTONE_CREATED : MILESTONE_RELEASE];
+    size_t newest = SIZE_MAX;
+    size_t second = SIZE_MAX;
+    size_t row;
+    size_t word;
+    uint64_t matched;
+
+    for(word = 0; word < table->words; word++) {
+        matched = table_filter(table, filter, key, word);
+        while(matched) {
+            row = word * ROWS_PER_WORD + lowest_bit(matched);
+            matched &= matched - 1;
+            if(selector == KERNEL_FIRST) {
+                return table->rows[row];
+            }
+            if(newest == SIZE_MAX || column[row] >= column[newest]) {
+                second = newest;
+                newest = row;
+            } else if(second != SIZE_MAX && column[row] >= column[second]) {
+                second = row;
+            }
+        }
+    }
+    if(selector == KERNEL_OLDSTABLE) {
+        return second == SIZE_MAX ? NULL : table->rows[second];
+    }
+    return newest == SIZE_MAX ? NULL : table->rows[newest];
+}
+
+typedef const distro_t *(*select_kernel_t)(const distro_table_t*, const date_t*);
+
+#define DEFINE_SELECT_KERNEL(filter, selector) \
+    static const distro_t *select_##filter##_##selector( \
+            const distro_table_t *table, const date_t *date) { \
+        return select_kernel(table, date, &filter_##filter, \
+                             KERNEL_SELECT_##selector); \
+    }
+#define KERNEL_SELECT_first KERNEL_FIRST
+#define KERNEL_SELECT_latest_created KERNEL_LATEST_CREATED
+#define KERNEL_SELECT_latest_release KERNEL_LATEST_RELEASE
+#define KERNEL_SELECT_oldstable KERNEL_OLDSTABLE
+KERNEL_SELECTORS(DEFINE_SELECT_KERNEL)
+
+typedef struct {
+    const filter_t *filter;
+    const distro_t *(*select_cb)(const distro_elem_t*);
+    const char *name;
+    select_kernel_t kernel;
+} select_kernel_entry_t;
+
+#define SELECT_KERNEL_ENTRY(filter, selector) \
+    {&filter_##filter, select_##selector, #filter "/" #selector, \
+     select_##filter##_##selector},
+
+static const select_kernel_entry_t select_kernels[] = {
+    KERNEL_SELECTORS(SELECT_KERNEL_ENTRY)
+};
+
+#define SELECT_KERNEL_COUNT (sizeof(select_kernels) / sizeof(select_kernels[0]))
+
+#define KERNEL_SELECTOR(filter, selector) {&filter_##filter, select_##selector},
+
+// The selectors of select_kernels, for sweeps
+static const selector_t kernel_selectors[] = {KERNEL_SELECTORS(KERNEL_SELECTOR)};
+
+// Index of the select kernel of filter and select_cb or SIZE_MAX if there is none
+static size_t select_kernel_index(const filter_t *filter,
+                                  const distro_t *(*select_cb)(const distro_elem_t*)) {
+    size_t i;
+
+    for(i = 0; i < SELECT_KERNEL_COUNT; i++) {
+        if(select_kernels[i].filter == filter && select_kernels[i].select_cb == select_cb) {
+            return i;
+        }
+    }
+    return SIZE_MAX;
+}
+
+/* get_distro() for the table of distro_list, using the select kernel of
+ * filter and select_cb if there is one.
+ */
+static const distro_t *select_distro(const distro_elem_t *distro_list,
+                                     const distro_table_t *table,
+                                     const date_t *date, const filter_t *filter,
+                                     const distro_t *(*select_cb)(const distro_elem_t*)) {
+    const size_t i = select_kernel_index(filter, select_cb);
+
+    if(i != SIZE_MAX) {
+        return select_kernels[i].kernel(table, date);
+    }
+    return get_distro(distro_list, date, filter, select_cb);
+}
+
+static void report_no_answer(const distro_table_t *table, const query_t *query) {
+    const char *suggestion;
+
+    if(query->series) {
+        suggestion = suggest_series(table, query->series);
+        if(suggestion) {
+            fprintf(stderr, NAME ": unknown distribution series `%s' (did you "
+                    "mean `%s'?)\n", query->series, suggestion);
+        } else {
+            fprintf(stderr, NAME ": unknown distribution series `%s'\n",
+                    query->series);
+        }
+    } else {
+        fprintf(stderr, NAME ": " OUTDATED_ERROR "\n");
+    }
+}
+
+/* Answer query for date, writing the result to stream. Returns false if
+ * there is no answer (see report_no_answer()).
+ */
+static bool run_query(FILE *stream, const distro_elem_t *distro_list,
+                      const distro_table_t *table, const query_t *query,
+                      const date_t *date) {
+    const distro_t *selected;
+
+#ifdef DEBIAN
+    if(query->alias) {
+        const distro_t *oldstable = select_distro(distro_list, table, date,
+                                                  &filter_oldstable, select_oldstable);
+        const distro_t *stable = select_distro(distro_list, table, date,
+                                               &filter_stable, select_latest_release);
+        const distro_t *testing = select_distro(distro_list, table, date,
+                                                &filter_testing, select_latest_created);
+        const distro_t *unstable = select_distro(distro_list, table, date,
+                                                 &filter_devel, select_first);
+        if(unlikely(oldstable == NULL || stable == NULL || testing == NULL ||
+                    unstable == NULL)) {
+            return false;
+        } else if(strcmp(oldstable->series, query->alias) == 0) {
+            fprintf(stream, "oldstable\n");
+        } else if(strcmp(stable->series, query->alias) == 0) {
+            fprintf(stream, "stable\n");
+        } else if(strcmp(testing->series, query->alias) == 0) {
+            fprintf(stream, "testing\n");
+        } else if(strcmp(unstable->series, query->alias) == 0) {
+            fprintf(stream, "unstable\n");
+        } else {
+            fprintf(stream, "%s\n", query->alias);
+        }
+        return true;
+    }
+#endif
+
+    if(query->expr) {
+        return query_data(stream, table, date, query->date_index,
+                          query->just_days, query->expr, query->print_cb);
+    }
+    if(query->select_cb == NULL && !query->series &&
+       (query->limit > 0 || query->order != ORDER_FILE)) {
+        return list_rows(stream, table, date, query);
+    }
+    if(query->select_cb == NULL && !query->series) {
+        return filter_data(stream, table, date, query->date_index,
+                           query->just_days, query->filter, query->print_cb);
+    }
+
+    if(query->series) {
+        selected = select_series(distro_list, query->series);
+    } else {
+        selected = select_distro(distro_list, table, date, query->filter,
+                                 query->select_cb);
+#ifdef UBUNTU
+        if(selected == NULL && query->latest) {
+            selected = select_distro(distro_list, table, date, &filter_stable,
+                                     select_latest_release);
+        }
+#endif
+    }
+    if(selected == NULL) {
+        return false;
+    }
+    return query->print_cb(stream, selected, date, query->date_index,
+                           query->just_days);
+}
+
+enum STATUS_STATE {STATUS_UNRELEASED
+                  ,STATUS_STABLE
+                  ,STATUS_LTS
+#ifdef DEBIAN
+                  ,STATUS_ELTS
+#endif
+#ifdef UBUNTU
+                  ,STATUS_ESM
+#endif
+                  ,STATUS_EOL
+                  ,STATUS_STATE_COUNT
+};
+
+static const char *const status_states[] = {"unreleased", "stable", "lts",
+#ifdef DEBIAN
+                                             "elts",
+#endif
+#ifdef UBUNTU
+                                             "esm",
+#endif
+                                             "eol"};
+
+static const char *status_state(unsigned int predicates) {
+    if(!(predicates & PREDICATE(RELEASED))) {
+        return status_states[STATUS_UNRELEASED];
+    } else if(!(predicates & PREDICATE(EOL))) {
+#ifdef UBUNTU
+        if(predicates & PREDICATE(LTS)) {
+            return status_states[STATUS_LTS];
+        }
+#endif
+        return status_states[STATUS_STABLE];
+#ifdef DEBIAN
+    } else if(!(predicates & PREDICATE(EOL_LTS))) {
+        return status_states[STATUS_LTS];
+    } else if(!(predicates & PREDICATE(EOL_ELTS))) {
+        return status_states[STATUS_ELTS];
+#endif
+#ifdef UBUNTU
+    } else if(!(predicates & PREDICATE(EOL_ESM))) {
+        return status_states[STATUS_ESM];
+#endif
+    }
+    return status_states[STATUS_EOL];
+}
+
+/* Print a table with the lifecycle state, the role and the days to every
+ * milestone of all distributions for date. The roles are looked up once;
+ * the rows are then written in one pass into one buffer.
+ */
+maybe_unused static bool print_status(FILE *stream, const distro_elem_t *distro_list,
+                                      const date_t *date) {
+    const struct {
+        const char *name;
+        const distro_t *distro;
+    } roles[] = {
+#ifdef DEBIAN
+        {"oldstable", get_distro(distro_list, date, &filter_oldstable, select_oldstable)},
+        {"stable", get_distro(distro_list, date, &filter_stable, select_latest_release)},
+        {"testing", get_distro(distro_list, date, &filter_testing, select_latest_created)},
+        {"unstable", get_distro(distro_list, date, &filter_devel, select_first)},
+#endif
+#ifdef UBUNTU
+        {"devel", get_distro(distro_list, date, &filter_devel, select_latest_created)},
+        {"stable", get_distro(distro_list, date, &filter_stable, select_latest_release)},
+        {"lts", get_distro(distro_list, date, &filter_lts, select_latest_release)},
+#endif
+    };
+    const distro_elem_t *current;
+    const distro_t *distro;
+    char *buffer;
+    size_t size;
+    ssize_t days;
+    FILE *out;
+    bool role;
+    bool success;
+    size_t r;
+    int i;
+
+    out = open_memstream(&buffer, &size);
+    fprintf(out, "series\tstate\trole");
+    for(i = 0; i < (int)MILESTONE_COUNT; i++) {
+        fprintf(out, "\t%s", milestones[i]);
+    }
+    fputc('\n', out);
+
+    for(current = distro_list; current != NULL; current = current->next) {
+        distro = current->distro;
+        fprintf(out, "%s\t%s\t", distro->series,
+                status_state(row_predicates(date, distro)));
+        role = false;
+        for(r = 0; r < sizeof(roles) / sizeof(roles[0]); r++) {
+            if(roles[r].distro == distro) {
+                fprintf(out, "%s%s", role ? "," : "", roles[r].name);
+                role = true;
+            }
+        }
+        if(!role) {
+            fputc('-', out);
+        }
+        for(i = 0; i < (int)MILESTONE_COUNT; i++) {
+            if(calculate_days(distro, date, i, &days)) {
+                fprintf(out, "\t%zd", days);
+            } else {
+                fprintf(out, "\t" UNKNOWN_DAYS);
+            }
+        }
+        fputc('\n', out);
+    }
+    fclose(out);
+
+    success = fwrite(buffer, 1, size, stream) == size;
+    free(buffer);
+    return success;
+}
+
+#define METRIC_PREFIX "distro_info_"
+#define METRIC_LABELS "{vendor=\"" CSV_NAME "\",series=\"%s\""
+
+/* Write the support lifetime of all distributions at date in the
+ * Prometheus text format. The rows are scanned once; the samples of the
+ * second metric family are collected on the side, because the samples of
+ * a family have to stay together.
+ */
+maybe_unused static void print_metrics(FILE *stream, const distro_elem_t *distro_list,
+                                       const date_t *date, time_t data_mtime) {
+    const distro_elem_t *current;
+    const char *state;
+    char *states;
+    size_t size;
+    ssize_t days;
+    FILE *state_stream;
+    int i;
+
+    state_stream = open_memstream(&states, &size);
+    fprintf(stream, "# HELP " METRIC_PREFIX "days_to_milestone Days until the "
+            "milestone is reached (negative if it was reached before).\n"
+            "# TYPE " METRIC_PREFIX "days_to_milestone gauge\n");
+    fprintf(state_stream, "# HELP " METRIC_PREFIX "state 1 for the current lifecycle "
+            "state, 0 for the others (unreleased, stable, lts, "
+#ifdef DEBIAN
+            "elts, "
+#endif
+#ifdef UBUNTU
+            "esm, "
+#endif
+            "or eol).\n"
+            "# TYPE " METRIC_PREFIX "state gauge\n");
+
+    for(current = distro_list; current != NULL; current = current->next) {
+        for(i = 0; i < (int)MILESTONE_COUNT; i++) {
+            if(calculate_days(current->distro, date, i, &days)) {
+                fprintf(stream, METRIC_PREFIX "days_to_milestone" METRIC_LABELS
+                        ",milestone=\"%s\"} %zd\n", current->distro->series,
+                        milestones[i], days);
+            }
+        }
+        state = status_state(row_predicates(date, current->distro));
+        for(i = 0; i < (int)STATUS_STATE_COUNT; i++) {
+            fprintf(state_stream, METRIC_PREFIX "state" METRIC_LABELS
+                    ",state=\"%s\"} %i\n", current->distro->series,
+                    status_states[i], status_states[i] == state);
+        }
+    }
+
+    fclose(state_stream);
+    fwrite(states, 1, size, stream);
+    free(states);
+    fprintf(stream, "# HELP " METRIC_PREFIX "data_age_seconds Seconds since the "
+            "data was modified or its data version was published.\n"
+            "# TYPE " METRIC_PREFIX "data_age_seconds gauge\n"
+            METRIC_PREFIX "data_age_seconds{vendor=\"" CSV_NAME "\"} %jd\n",
+            (intmax_t)(time(NULL) - data_mtime));
+}
+
+/* Replace filename by the size bytes at buffer, so that readers either see
+ * the old or the new content. Errors are only printed if report is set.
+ */
+static bool write_atomically(const char *filename, const char *buffer,
+                             size_t size, bool report) {
+    char *temp;
+    FILE *f;
+    int fd;
+    bool success;
+
+    temp = malloc(strlen(filename) + 8);
+    sprintf(temp, "%s.XXXXXX", filename);
+    fd = mkstemp(temp);
+    if(fd < 0) {
+        if(report) {
+            fprintf(stderr, NAME ": Failed to create a temporary file for %s: %s\n",
+                    filename, strerror(errno));
+        }
+        free(temp);
+        return false;
+    }
+    fchmod(fd, 0644);
+    f = fdopen(fd, "w");
+    success = fwrite(buffer, 1, size, f) == size;
+    success = fclose(f) == 0 && success;
+    if(!success || rename(temp, filename) != 0) {
+        if(report) {
+            fprintf(stderr, NAME ": Failed to write %s: %s\n", filename,
+                    strerror(errno));
+        }
+        unlink(temp);
+        success = false;
+    }
+    free(temp);
+    return success;
+}
+
+// --join: the roles of the other vendor
+
+#ifdef DEBIAN
+#define JOIN_CSV_NAME "ubuntu"
+#endif
+#ifdef UBUNTU
+#define JOIN_CSV_NAME "debian"
+#endif
+#define CSV_FIELD(id, name) "," name
+#define JOIN_CSV_HEADER "version,codename,series" JOIN_MILESTONES(CSV_FIELD)
+
+#define JOIN_ROLE(filter, role, require, exclude, select) \
+    {#role, {#role, require, exclude}, select_##select},
+
+static const join_role_t join_roles[] = {JOIN_ROLES(JOIN_ROLE, JOIN_PREDICATE)};
+
+#define JOIN_ROLE_COUNT (sizeof(join_roles) / sizeof(join_roles[0]))
+
+/* Parse MILESTONE:ROLE. Prints an error and returns false if it is invalid. */
+maybe_unused static bool parse_join(const char *string, int *milestone_index,
+                                    const join_role_t **role) {
+    const char *colon = strchr(string, ':');
+    char *milestone;
+    size_t i;
+
+    if(colon == NULL) {
+        fprintf(stderr, NAME ": invalid join `%s' (expected MILESTONE:ROLE)\n",
+                string);
+        return false;
+    }
+    milestone = strndup(string, colon - string);
+    *milestone_index = milestone_to_index(milestone);
+    if(*milestone_index < 0) {
+        fprintf(stderr, NAME ": invalid milestone: %s\n", milestone);
+        free(milestone);
+        return false;
+    }
+    free(milestone);
+    for(i = 0; i < JOIN_ROLE_COUNT; i++) {
+        if(strcmp(colon + 1, join_roles[i].name) == 0) {
+            *role = &join_roles[i];
+            return true;
+        }
+    }
+    fprintf(stderr, NAME ": invalid " JOIN_CSV_NAME " role `%s' (expected ",
+            colon + 1);
+    for(i = 0; i < JOIN_ROLE_COUNT; i++) {
+        fprintf(stderr, "%s%s", join_roles[i].name,
+                i + 1 == JOIN_ROLE_COUNT ? ")\n" : ", ");
+    }
+    return false;
+}
+
+// Sorted list of all milestone dates in the table. Returns the count.
+static size_t milestone_events(const distro_table_t *table, datekey_t **events) {
+    size_t count = 0;
+    size_t row;
+    size_t i;
+    int milestone_index;
+
+    *events = malloc((table->count * MILESTONE_COUNT + 1) * sizeof(datekey_t));
+    for(milestone_index = 0; milestone_index < (int)MILESTONE_COUNT;
+        milestone_index++) {
+        for(row = 0; row < table->count; row++) {
+            if(table->columns[milestone_index][row] != DATEKEY_ABSENT) {
+                (*events)[count++] = table->columns[milestone_index][row];
+            }
+        }
+    }
+    qsort(*events, count, sizeof(datekey_t), compare_datekeys);
+
+    for(row = 0, i = 0; row < count; row++) {
+        if(i == 0 || (*events)[i - 1] != (*events)[row]) {
+            (*events)[i++] = (*events)[row];
+        }
+    }
+    return i;
+}
+
+typedef struct {
+    char *line;
+    date_t date;
+    datekey_t key;
+    size_t answer;
+} dated_answer_t;
+
+static int compare_dated_answers(const void *a, const void *b) {
+    const dated_answer_t *x = *(const dated_answer_t * const *)a;
+    const dated_answer_t *y = *(const dated_answer_t * const *)b;
+
+    return x->key < y->key ? -1 : x->key > y->key;
+}
+
+/* Answer query for every date listed in filename (standard input for "-")
+ * and print the answers as "date<TAB>answer" lines in input order.
+ *
+ * The answer can only change on a milestone date. The dates are sorted and
+ * swept against the sorted milestone dates, so that the query is run only
+ * once per interval between two milestones (once per distinct date if the
+ * days until a milestone are printed). Dates without an answer get an empty
+ * one.
+ */
+maybe_unused static bool run_dates(const char *filename, const distro_elem_t *distro_list,
+                                   const distro_table_t *table, const query_t *query) {
+    FILE *f;
+    FILE *stream;
+    char *line = NULL;
+    char *next;
+    char **answers = NULL;
+    datekey_t *events;
+    dated_answer_t *dates = NULL;
+    dated_answer_t **sorted;
+    size_t capacity = 0;
+    size_t count = 0;
+    size_t n_answers = 0;
+    size_t n_events;
+    size_t event = 0;
+    size_t length;
+    size_t size;
+    size_t i;
+    ssize_t read;
+    int lineno = 0;
+    bool valid = true;
+    bool success = true;
+
+    f = strcmp(filename, "-") == 0 ? stdin : fopen(filename, "r");
+    if(unlikely(f == NULL)) {
+        fprintf(stderr, NAME ": Failed to open %s: %s\n", filename,
+                strerror(errno));
+        return false;
+    }
+    while((read = getline(&line, &length, f)) != -1) {
+        lineno++;
+        line[strcspn(line, "\r\n")] = '\0';
+        if(*line == '\0') {
+            continue;
+        }
+        if(count == capacity) {
+            capacity = capacity ? 2 * capacity : 1024;
+            dates = realloc(dates, capacity * sizeof(dated_answer_t));
+        }
+        if(unlikely(!parse_date(line, &dates[count].date))) {
+            fprintf(stderr, NAME ": Invalid date `%s' in file `%s' at line %i.\n",
+                    line, filename, lineno);
+            valid = false;
+            continue;
+        }
+        dates[count].line = strdup(line);
+        dates[count].key = date_to_key(&dates[count].date);
+        count++;
+    }
+    free(line);
+    if(f != stdin) {
+        fclose(f);
+    }
+
+    sorted = malloc(count * sizeof(dated_answer_t *));
+    for(i = 0; i < count; i++) {
+        sorted[i] = &dates[i];
+    }
+    qsort(sorted, count, sizeof(dated_answer_t *), compare_dated_answers);
+    n_events = milestone_events(table, &events);
+    answers = malloc(count * sizeof(char *));
+
+    for(i = 0; i < count && valid; i++) {
+        size_t previous = event;
+
+        while(event < n_events && events[event] <= sorted[i]->key) {
+            event++;
+        }
+        if(i == 0 || event != previous ||
+           (query->date_index >= 0 && sorted[i]->key != sorted[i - 1]->key)) {
+            stream = open_memstream(&answers[n_answers], &size);
+            if(!run_query(stream, distro_list, table, query, &sorted[i]->date)) {
+                report_no_answer(table, query);
+                success = false;
+            }
+            fclose(stream);
+            n_answers++;
+        }
+        sorted[i]->answer = n_answers - 1;
+    }
+
+    for(i = 0; i < count && valid; i++) {
+        line = answers[dates[i].answer];
+        if(*line == '\0') {
+            printf("%s\t\n", dates[i].line);
+        }
+        while(*line != '\0') {
+            next = strchr(line, '\n');
+            printf("%s\t%.*s\n", dates[i].line, (int)(next - line), line);
+            line = next + 1;
+        }
+    }
+
+    for(i = 0; i < n_answers; i++) {
+        free(answers[i]);
+    }
+    for(i = 0; i < count; i++) {
+        free(dates[i].line);
+    }
+    free(answers);
+    free(events);
+    free(sorted);
+    free(dates);
+    return valid && success;
+}
+
+static inline date_t key_to_date(datekey_t key) {
+    date_t date;
+
+    date.year = key >> 9;
+    date.month = (key >> 5) & 0xf;
+    date.day = key & 0x1f;
+    return date;
+}
+
+static void next_day(date_t *date) {
+    if(date->day < (is_leap_year(date->year) &&
+                    date->month == 2 ? 29 : days_in_month[date->month-1])) {
+        date->day++;
+    } else if(date->month < 12) {
+        date->day = 1;
+        date->month++;
+    } else {
+        date->day = 1;
+        date->month = 1;
+        date->year++;
+    }
+}
+
+// Milestone sweep
+
+static void rank_init(rank_set_t *set, size_t count) {
+    set->words = (count + ROWS_PER_WORD - 1) / ROWS_PER_WORD;
+    set->bits = calloc(set->words + 1, sizeof(uint64_t));
+    set->summary = calloc(set->words / ROWS_PER_WORD + 1, sizeof(uint64_t));
+}
+
+static void rank_free(rank_set_t *set) {
+    free(set->bits);
+    free(set->summary);
+}
+
+static inline void rank_add(rank_set_t *set, size_t position) {
+    const size_t word = position / ROWS_PER_WORD;
+
+    set->bits[word] |= (uint64_t)1 << (position % ROWS_PER_WORD);
+    set->summary[word / ROWS_PER_WORD] |= (uint64_t)1 << (word % ROWS_PER_WORD);
+}
+
+static inline void rank_remove(rank_set_t *set, size_t position) {
+    const size_t word = position / ROWS_PER_WORD;
+
+    set->bits[word] &= ~((uint64_t)1 << (position % ROWS_PER_WORD));
+    if(set->bits[word] == 0) {
+        set->summary[word / ROWS_PER_WORD] &= ~((uint64_t)1 << (word % ROWS_PER_WORD));
+    }
+}
+
+// Lowest position in set or SIZE_MAX if it is empty.
+static size_t rank_first(const rank_set_t *set) {
+    size_t summary;
+    size_t word;
+
+    for(summary = 0; summary <= set->words / ROWS_PER_WORD; summary++) {
+        if(set->summary[summary] != 0) {
+            word = summary * ROWS_PER_WORD + lowest_bit(set->summary[summary]);
+            return word * ROWS_PER_WORD + lowest_bit(set->bits[word]);
+        }
+    }
+    return SIZE_MAX;
+}
+
+// Highest position in set below limit or SIZE_MAX if there is none.
+static size_t rank_previous(const rank_set_t *set, size_t limit) {
+    const size_t last = limit / ROWS_PER_WORD;
+    uint64_t masked;
+    size_t summary;
+    size_t word;
+
+    if(last < set->words) {
+        masked = set->bits[last] & (((uint64_t)1 << (limit % ROWS_PER_WORD)) - 1);
+        if(masked != 0) {
+            return last * ROWS_PER_WORD + highest_bit(masked);
+        }
+    }
+    for(summary = last / ROWS_PER_WORD + 1; summary-- > 0;) {
+        if(summary > set->words / ROWS_PER_WORD) {
+            continue;
+        }
+        masked = set->summary[summary];
+        if(summary == last / ROWS_PER_WORD) {
+            masked &= ((uint64_t)1 << (last % ROWS_PER_WORD)) - 1;
+        }
+        if(masked != 0) {
+            word = summary * ROWS_PER_WORD + highest_bit(masked);
+            return word * ROWS_PER_WORD + highest_bit(set->bits[word]);
+        }
+    }
+    return SIZE_MAX;
+}
+
+static inline size_t rank_last(const rank_set_t *set) {
+    return rank_previous(set, set->words * ROWS_PER_WORD);
+}
+
+static int compare_row_events(const void *a, const void *b) {
+    const row_event_t *event1 = a;
+    const row_event_t *event2 = b;
+
+    if(event1->key != event2->key) {
+        return event1->key < event2->key ? -1 : 1;
+    }
+    return event1->row < event2->row ? -1 : event1->row > event2->row;
+}
+
+/* Every known milestone date of the rows of table in date order (like
+ * milestone_events(), but with the row). Returns the number of events.
+ */
+static size_t row_events(const distro_table_t *table, row_event_t **events) {
+    size_t count = 0;
+    size_t row;
+    int milestone_index;
+
+    *events = malloc((table->count * MILESTONE_COUNT + 1) * sizeof(row_event_t));
+    for(milestone_index = 0; milestone_index < (int)MILESTONE_COUNT;
+        milestone_index++) {
+        for(row = 0; row < table->count; row++) {
+            if(table->columns[milestone_index][row] != DATEKEY_ABSENT) {
+                (*events)[count++] = (row_event_t){table->columns[milestone_index][row], row};
+            }
+        }
+    }
+    qsort(*events, count, sizeof(row_event_t), compare_row_events);
+    return count;
+}
+
+static inline bool row_reached(const distro_table_t *table, int milestone_index,
+                               size_t row, datekey_t key, bool absent_reached) {
+    const datekey_t date = table->columns[milestone_index][row];
+
+    return date <= key || (absent_reached && date == DATEKEY_ABSENT);
+}
+
+#define TABLE_ROW_REACHED(milestone) \
+    row_reached(table, MILESTONE_##milestone, row, key, false)
+#define TABLE_ROW_PASSED(milestone) \
+    row_reached(table, MILESTONE_##milestone, row, key, true)
+
+// Counterpart of table_predicate() for all predicates of one row
+static unsigned int table_row_predicates(const distro_table_t *table, size_t row,
+                                         datekey_t key) {
+    const size_t word = row / ROWS_PER_WORD;
+    const uint64_t bit = (uint64_t)1 << (row % ROWS_PER_WORD);
+    const bool versioned = (table->versioned[word] & bit) != 0;
+    unsigned int predicates = 0;
+
+    VENDOR_RULES(ROW_RULE, TABLE_ROW_REACHED, TABLE_ROW_PASSED, versioned,
+                 (table->lts[word] & bit) != 0)
+    return predicates;
+}
+
+#define JOIN_TABLE_ROW_REACHED(milestone) \
+    row_reached(table, JOIN_MILESTONE_##milestone, row, key, false)
+#define JOIN_TABLE_ROW_PASSED(milestone) \
+    row_reached(table, JOIN_MILESTONE_##milestone, row, key, true)
+#define JOIN_ROW_RULE(predicate, condition) \
+    if(condition) { \
+        predicates |= JOIN_PREDICATE(predicate); \
+    }
+
+/* table_row_predicates() for a table of the other vendor (see --join),
+ * which has the same number of milestones.
+ */
+static unsigned int join_table_row_predicates(const distro_table_t *table,
+                                              size_t row, datekey_t key) {
+    const bool versioned = *table->rows[row]->version != '\0';
+    unsigned int predicates = 0;
+
+    JOIN_RULES(JOIN_ROW_RULE, JOIN_TABLE_ROW_REACHED, JOIN_TABLE_ROW_PASSED,
+               versioned, strstr(table->rows[row]->version, "LTS") != NULL)
+    return predicates;
+}
+
+static inline bool accepts(const filter_t *filter, unsigned int predicates) {
+    return (predicates & filter->require) == filter->require &&
+           (predicates & filter->exclude) == 0;
+}
+
+static inline enum RANK selector_rank(const selector_t *selector) {
+    return selector->select_cb == select_latest_created ? RANK_CREATED : RANK_RELEASE;
+}
+
+/* Row that the select callback of selector picks from the matching rows
+ * of sweep (SIZE_MAX if none). The callbacks pick the last row with the
+ * highest date, except for select_oldstable(), which picks the one before
+ * that in date order, but only if the newest row is not the first one.
+ */
+static size_t sweep_selected(const sweep_t *sweep, size_t selector) {
+    const distro_t *(*select_cb)(const distro_elem_t*) =
+        sweep->selectors[selector].select_cb;
+    const enum RANK rank = selector_rank(&sweep->selectors[selector]);
+    size_t newest;
+    size_t second;
+
+    if(select_cb == select_first) {
+        return rank_first(&sweep->rows[selector]);
+    }
+    newest = rank_last(&sweep->ranks[selector]);
+    if(newest == SIZE_MAX || select_cb != select_oldstable) {
+        return newest == SIZE_MAX ? SIZE_MAX : sweep->ranked[rank][newest];
+    }
+    if(rank_first(&sweep->rows[selector]) == sweep->ranked[rank][newest]) {
+        return SIZE_MAX;
+    }
+    second = rank_previous(&sweep->ranks[selector], newest);
+    return second == SIZE_MAX ? SIZE_MAX : sweep->ranked[rank][second];
+}
+
+// Set the predicates of row and update the rows of every selector.
+static void sweep_update(sweep_t *sweep, size_t row, unsigned int predicates) {
+    const unsigned int previous = sweep->predicates[row];
+    bool member;
+    size_t i;
+
+    sweep->predicates[row] = predicates;
+    for(i = 0; i < sweep->n_selectors; i++) {
+        const selector_t *selector = &sweep->selectors[i];
+
+        member = accepts(selector->filter, predicates);
+        if(member == accepts(selector->filter, previous)) {
+            continue;
+        }
+        if(member) {
+            rank_add(&sweep->rows[i], row);
+            rank_add(&sweep->ranks[i], sweep->rank[selector_rank(selector)][row]);
+        } else {
+            rank_remove(&sweep->rows[i], row);
+            rank_remove(&sweep->ranks[i], sweep->rank[selector_rank(selector)][row]);
+        }
+    }
+}
+
+/* Start a sweep for the n_selectors selectors over the milestones of table
+ * after key with the predicates (given by predicates_cb) of all rows on key.
+ */
+static void sweep_init(sweep_t *sweep, const distro_table_t *table, datekey_t key,
+                       const selector_t *selectors, size_t n_selectors,
+                       unsigned int (*predicates_cb)(const distro_table_t*, size_t,
+                                                     datekey_t)) {
+    static const int rank_milestones[RANK_COUNT] = {MILESTONE_CREATED,
+                                                    MILESTONE_RELEASE};
+    row_event_t *order;
+    size_t row;
+    size_t i;
+    int rank;
+
+    sweep->table = table;
+    sweep->selectors = selectors;
+    sweep->n_selectors = n_selectors;
+    sweep->n_events = row_events(table, &sweep->events);
+    sweep->next = 0;
+    while(sweep->next < sweep->n_events && sweep->events[sweep->next].key <= key) {
+        sweep->next++;
+    }
+    sweep->predicates = malloc((table->count + 1) * sizeof(unsigned int));
+    order = malloc((table->count + 1) * sizeof(row_event_t));
+    for(rank = 0; rank < RANK_COUNT; rank++) {
+        sweep->ranked[rank] = malloc((table->count + 1) * sizeof(size_t));
+        sweep->rank[rank] = malloc((table->count + 1) * sizeof(size_t));
+        for(row = 0; row < table->count; row++) {
+            order[row] = (row_event_t){table->columns[rank_milestones[rank]][row], row};
+        }
+        qsort(order, table->count, sizeof(row_event_t), compare_row_events);
+        for(row = 0; row < table->count; row++) {
+            sweep->ranked[rank][row] = order[row].row;
+            sweep->rank[rank][order[row].row] = row;
+        }
+    }
+    free(order);
+    sweep->rows = malloc((n_selectors + 1) * sizeof(rank_set_t));
+    sweep->ranks = malloc((n_selectors + 1) * sizeof(rank_set_t));
+    for(i = 0; i < n_selectors; i++) {
+        rank_init(&sweep->rows[i], table->count);
+        rank_init(&sweep->ranks[i], table->count);
+    }
+    for(row = 0; row < table->count; row++) {
+        sweep->predicates[row] = predicates_cb(table, row, key);
+        for(i = 0; i < n_selectors; i++) {
+            if(accepts(selectors[i].filter, sweep->predicates[row])) {
+                rank_add(&sweep->rows[i], row);
+                rank_add(&sweep->ranks[i], sweep->rank[selector_rank(&selectors[i])][row]);
+            }
+        }
+    }
+}
+
+static void sweep_free(sweep_t *sweep) {
+    size_t i;
+    int rank;
+
+    for(i = 0; i < sweep->n_selectors; i++) {
+        rank_free(&sweep->rows[i]);
+        rank_free(&sweep->ranks[i]);
+    }
+    for(rank = 0; rank < RANK_COUNT; rank++) {
+        free(sweep->rank[rank]);
+        free(sweep->ranked[rank]);
+    }
+    free(sweep->rows);
+    free(sweep->ranks);
+    free(sweep->predicates);
+    free(sweep->events);
+}
+
+// Date of the next milestone of the sweep (DATEKEY_ABSENT at the end)
+static inline datekey_t sweep_next(const sweep_t *sweep) {
+    return sweep->next < sweep->n_events ? sweep->events[sweep->next].key : DATEKEY_ABSENT;
+}
+
+/* For every distribution, print its series, the date of the given milestone
+ * and the series that had the given role of the other vendor on that date.
+ * The milestone dates are visited in date order by a sweep over the table
+ * of the other vendor, which keeps the rows with the role up to date.
+ */
+maybe_unused static void print_join(FILE *stream, const distro_elem_t *distro_list,
+                                    const distro_elem_t *join_list, int milestone_index,
+                                    const join_role_t *role) {
+    const selector_t selector = {&role->filter, role->select_cb};
+    distro_table_t *join_table = table_columns(join_list);
+    const distro_elem_t *current;
+    const distro_t **answers;
+    row_event_t *dates;
+    sweep_t sweep;
+    size_t n_rows = 0;
+    size_t n_dates = 0;
+    size_t row;
+    size_t i;
+
+    for(current = distro_list; current != NULL; current = current->next) {
+        n_rows++;
+    }
+    dates = malloc((n_rows + 1) * sizeof(row_event_t));
+    for(current = distro_list, i = 0; current != NULL; current = current->next, i++) {
+        if(current->distro->milestones[milestone_index]) {
+            dates[n_dates++] = (row_event_t){
+                date_to_key(current->distro->milestones[milestone_index]), i};
+        }
+    }
+    qsort(dates, n_dates, sizeof(row_event_t), compare_row_events);
+
+    answers = calloc(n_rows + 1, sizeof(distro_t *));
+    sweep_init(&sweep, join_table, 0, &selector, 1, join_table_row_predicates);
+    for(i = 0; i < n_dates; i++) {
+        while(sweep_next(&sweep) <= dates[i].key) {
+            row = sweep.events[sweep.next++].row;
+            sweep_update(&sweep, row,
+                         join_table_row_predicates(join_table, row, dates[i].key));
+        }
+        row = sweep_selected(&sweep, 0);
+        answers[dates[i].row] = row == SIZE_MAX ? NULL : join_table->rows[row];
+    }
+
+    for(current = distro_list, i = 0; current != NULL; current = current->next, i++) {
+        const date_t *milestone = current->distro->milestones[milestone_index];
+
+        if(milestone) {
+            fprintf(stream, "%s %04u-%02u-%02u %s\n", current->distro->series,
+                    milestone->year, milestone->month, milestone->day,
+                    answers[i] ? answers[i]->series : "-");
+        } else {
+            fprintf(stream, "%s - -\n", current->distro->series);
+        }
+    }
+
+    sweep_free(&sweep);
+    free_table(join_table);
+    free(answers);
+    free(dates);
+}
+
+/* Render the answer to query for date. Returns NULL if there is none.
+ * The caller has to free the returned string.
+ */
+static char *render_answer(const distro_elem_t *distro_list,
+                           const distro_table_t *table, const query_t *query,
+                           const date_t *date) {
+    FILE *stream;
+    char *answer;
+    size_t size;
+    bool success;
+
+    stream = open_memstream(&answer, &size);
+    success = run_query(stream, distro_list, table, query, date);
+    fclose(stream);
+    if(!success) {
+        free(answer);
+        return NULL;
+    }
+    return answer;
+}
+
+static inline bool same_answer(const char *answer1, const char *answer2) {
+    return answer1 == answer2 ||
+           (answer1 && answer2 && strcmp(answer1, answer2) == 0);
+}
+
+#define QUERY_SELECTORS 4
+
+/* Store the select kernels whose selections determine the answer to query
+ * in selectors. Returns their number (0 for the options that list
+ * versions) or SIZE_MAX if a selection has no select kernel.
+ */
+static size_t query_selectors(const query_t *query, size_t *selectors) {
+    size_t count = 0;
+    size_t i;
+
+#ifdef DEBIAN
+    if(query->alias) {
+        selectors[count++] = select_kernel_index(&filter_oldstable, select_oldstable);
+        selectors[count++] = select_kernel_index(&filter_stable, select_latest_release);
+        selectors[count++] = select_kernel_index(&filter_testing, select_latest_created);
+        selectors[count++] = select_kernel_index(&filter_devel, select_first);
+    } else
+#endif
+    if(query->expr == NULL && query->select_cb != NULL) {
+        selectors[count++] = select_kernel_index(query->filter, query->select_cb);
+#ifdef UBUNTU
+        if(query->latest) {
+            selectors[count++] = select_kernel_index(&filter_stable, select_latest_release);
+        }
+#endif
+    }
+    for(i = 0; i < count; i++) {
+        if(selectors[i] == SIZE_MAX) {
+            return SIZE_MAX;
+        }
+    }
+    return count;
+}
+
+// Whether the list of query contains row on key.
+static bool query_lists(const distro_table_t *table, const query_t *query,
+                        size_t row, datekey_t key, uint64_t *stack) {
+    if(query->expr) {
+        return (table_expr(table, query->expr, key, row / ROWS_PER_WORD, stack) >>
+                (row % ROWS_PER_WORD)) & 1;
+    }
+    return accepts(query->filter, table_row_predicates(table, row, key));
+}
+
+/* Find the first date after date on which the answer to query differs.
+ * Answers only change on milestone dates, so the milestones after date are
+ * swept in date order and only the rows with a milestone on that date are
+ * evaluated again: a list changes when one of them enters or leaves it, a
+ * selection can change when a select kernel picks another row. Answers that
+ * can stay the same (a list with --limit or a selection) are rendered again
+ * to check. If the days until a milestone are printed, the answer changes
+ * every day. Returns false if no known milestone changes the answer.
+ */
+static bool find_next_change(const distro_elem_t *distro_list,
+                             const distro_table_t *table, const query_t *query,
+                             const date_t *date, date_t *change) {
+    datekey_t key = date_to_key(date);
+    datekey_t next;
+    sweep_t sweep;
+    size_t selectors[QUERY_SELECTORS];
+    size_t selected[QUERY_SELECTORS];
+    size_t n_selectors;
+    uint64_t *stack = NULL;
+    char *current = NULL;
+    char *answer;
+    size_t row;
+    size_t i;
+    bool rendered = false;
+    bool changed;
+    bool found = false;
+
+    if(query->date_index >= 0) {
+        *change = *date;
+        next_day(change);
+        return true;
+    }
+    if(query->series) {
+        // The version of a series does not depend on the date.
+        return false;
+    }
+
+    n_selectors = query_selectors(query, selectors);
+    if(query->expr) {
+        stack = malloc(query->expr->length * sizeof(uint64_t));
+    }
+    sweep_init(&sweep, table, key, kernel_selectors, SELECT_KERNEL_COUNT,
+               table_row_predicates);
+    for(i = 0; i < n_selectors && n_selectors != SIZE_MAX; i++) {
+        selected[i] = sweep_selected(&sweep, selectors[i]);
+    }
+    while(!found && (next = sweep_next(&sweep)) != DATEKEY_ABSENT) {
+        changed = n_selectors == SIZE_MAX;
+        while(sweep_next(&sweep) == next) {
+            row = sweep.events[sweep.next++].row;
+            if(n_selectors == 0 && !changed) {
+                changed = query_lists(table, query, row, key, stack) !=
+                          query_lists(table, query, row, next, stack);
+            }
+            sweep_update(&sweep, row, table_row_predicates(table, row, next));
+        }
+        for(i = 0; i < n_selectors && n_selectors != SIZE_MAX; i++) {
+            row = sweep_selected(&sweep, selectors[i]);
+            changed |= row != selected[i];
+            selected[i] = row;
+        }
+        key = next;
+        if(!changed) {
+            continue;
+        }
+        *change = key_to_date(next);
+        if(n_selectors == 0 && query->limit == 0) {
+            found = true;
+            continue;
+        }
+        if(!rendered) {
+            current = render_answer(distro_list, table, query, date);
+            rendered = true;
+        }
+        answer = render_answer(distro_list, table, query, change);
+        found = !same_answer(current, answer);
+        free(answer);
+    }
+
+    sweep_free(&sweep);
+    free(stack);
+    free(current);
+    return found;
+}
+
+// Result cache
+
+#define CACHE_FORMAT "2"
+
+// Number of intervals with their answer that an entry keeps
+#define CACHE_INTERVALS 16
+
+static inline const char *print_name(bool (*print_cb)(FILE*, const distro_t*,
+                                                      const date_t*, int, int)) {
+    return print_cb == print_fullname ? "fullname" :
+           print_cb == print_release ? "release" : "codename";
+}
+
+/* Return the key of a cache entry: the identity of the data file and the
+ * normalized query, or NULL if the data file cannot be stat'ed.
+ */
+maybe_unused static char *cache_key(const char *filename, const query_t *query) {
+    struct stat stat_buf;
+    char *key;
+    size_t size;
+    FILE *stream;
+
+    if(stat(filename, &stat_buf) != 0) {
+        return NULL;
+    }
+    stream = open_memstream(&key, &size);
+    fprintf(stream, NAME " " CACHE_FORMAT " %ju:%ju:%jd:%jd.%09ld",
+            (uintmax_t)stat_buf.st_dev, (uintmax_t)stat_buf.st_ino,
+            (intmax_t)stat_buf.st_size, (intmax_t)stat_buf.st_mtim.tv_sec,
+            stat_buf.st_mtim.tv_nsec);
+    fprintf(stream, " filter=%s select=%i series=%s query=%s",
+            query->filter ? query->filter->name : "",
+            query->select_cb != NULL, query->series ? query->series : "",
+            query->expr ? query->expr->source : "");
+#ifdef DEBIAN
+    fprintf(stream, " alias=%s", query->alias ? query->alias : "");
+#endif
+#ifdef UBUNTU
+    fprintf(stream, " latest=%i", query->latest);
+#endif
+    fprintf(stream, " print=%s days=%i just_days=%i", print_name(query->print_cb),
+            query->date_index, query->just_days);
+    fprintf(stream, " limit=%zu order=%i", query->limit, query->order);
+    fclose(stream);
+    // The key is stored in the first line of the entry.
+    key[strcspn(key, "\n")] = '\0';
+    return key;
+}
+
+// FNV-1a hash of length bytes at data.
+static uint64_t hash_bytes(const char *data, size_t length) {
+    uint64_t hash = UINT64_C(14695981039346656037);
+
+    while(length-- > 0) {
+        hash ^= (unsigned char)*data++;
+        hash *= UINT64_C(1099511628211);
+    }
+    return hash;
+}
+
+// Hash of the cache key, used as file name of the entry.
+static inline uint64_t hash_key(const char *key) {
+    return hash_bytes(key, strlen(key));
+}
+
+maybe_unused static char *cache_path(const char *cache_dir, const char *key) {
+    char *path = malloc(strlen(cache_dir) + 18);
+
+    sprintf(path, "%s/%016jx", cache_dir, (uintmax_t)hash_key(key));
+    return path;
+}
+
+/* Read the entry at path. Returns NULL if it cannot be read or belongs to
+ * another key, else the entry with *records pointing behind its key line.
+ * The caller has to free the returned entry.
+ */
+static char *cache_read(const char *path, const char *key, const char **records) {
+    struct stat stat_buf;
+    const size_t key_length = strlen(key);
+    char *entry;
+    ssize_t size;
+    int fd;
+
+    fd = open(path, O_RDONLY);
+    if(fd < 0) {
+        return NULL;
+    }
+    if(fstat(fd, &stat_buf) != 0) {
+        close(fd);
+        return NULL;
+    }
+    entry = malloc(stat_buf.st_size + 1);
+    size = read(fd, entry, stat_buf.st_size);
+    close(fd);
+    if(size == stat_buf.st_size) {
+        entry[size] = '\0';
+        if(strncmp(entry, key, key_length) == 0 && entry[key_length] == '\n') {
+            *records = entry + key_length + 1;
+            return entry;
+        }
+    }
+    free(entry);
+    return NULL;
+}
+
+/* Parse the record at *records: the interval [from, until) of dates, the
+ * number of lines of the answer, and the answer of length bytes that is
+ * valid in it. Advances *records to the next record. Returns false at the
+ * end of the entry or if the record is incomplete.
+ */
+static bool cache_record(const char **records, datekey_t *from, datekey_t *until,
+                         size_t *lines, const char **answer, size_t *length) {
+    const char *end;
+    size_t line;
+    int consumed;
+
+    if(sscanf(*records, "%" SCNu32 " %" SCNu32 " %zu%n", from, until, lines,
+              &consumed) != 3 || (*records)[consumed] != '\n') {
+        return false;
+    }
+    *answer = *records + consumed + 1;
+    for(end = *answer, line = 0; line < *lines; line++) {
+        end = strchr(end, '\n');
+        if(end == NULL) {
+            return false;
+        }
+        end++;
+    }
+    *length = end - *answer;
+    *records = end;
+    return true;
+}
+
+/* Print the cached answer if the entry at path matches key and has an
+ * answer that is valid on date. An entry consists of the key and up to
+ * CACHE_INTERVALS records of an interval of dates and the answer in it.
+ */
+maybe_unused static bool cache_lookup(const char *path, const char *key, const date_t *date) {
+    const datekey_t today = date_to_key(date);
+    const char *records;
+    const char *answer;
+    datekey_t from;
+    datekey_t until;
+    size_t lines;
+    size_t length;
+    char *entry;
+    bool hit = false;
+
+    entry = cache_read(path, key, &records);
+    if(entry == NULL) {
+        return false;
+    }
+    while(!hit && cache_record(&records, &from, &until, &lines, &answer, &length)) {
+        if(from <= today && today < until) {
+            fwrite(answer, sizeof(char), length, stdout);
+            hit = true;
+        }
+    }
+    free(entry);
+    return hit;
+}
+
+static size_t count_lines(const char *text) {
+    size_t lines = 0;
+
+    while((text = strchr(text, '\n')) != NULL) {
+        text++;
+        lines++;
+    }
+    return lines;
+}
+
+/* Store answer for the dates in [from, until) in front of the records of
+ * the other intervals of the entry. The entry is written to a temporary
+ * file and renamed, so concurrent readers never see a partial entry.
+ * Failures are ignored, the cache is only an optimization.
+ */
+maybe_unused static void cache_store(const char *cache_dir, const char *path,
+                                     const char *key, datekey_t from, datekey_t until,
+                                     const char *answer) {
+    const char *records;
+    const char *other;
+    datekey_t other_from;
+    datekey_t other_until;
+    size_t lines;
+    size_t length;
+    size_t kept;
+    char *entry;
+    char *temp;
+    FILE *f;
+    int fd;
+
+    if(mkdir(cache_dir, 0700) != 0 && errno != EEXIST) {
+        return;
+    }
+    temp = malloc(strlen(path) + 8);
+    sprintf(temp, "%s.XXXXXX", path);
+    fd = mkstemp(temp);
+    if(fd < 0) {
+        free(temp);
+        return;
+    }
+    f = fdopen(fd, "w");
+    fprintf(f, "%s\n%" PRIu32 " %" PRIu32 " %zu\n%s", key, from, until,
+            count_lines(answer), answer);
+    entry = cache_read(path, key, &records);
+    if(entry != NULL) {
+        kept = 1;
+        while(kept < CACHE_INTERVALS &&
+              cache_record(&records, &other_from, &other_until, &lines, &other,
+                           &length)) {
+            if(other_until <= from || until <= other_from) {
+                fprintf(f, "%" PRIu32 " %" PRIu32 " %zu\n", other_from, other_until,
+                        lines);
+                fwrite(other, sizeof(char), length, f);
+                kept++;
+            }
+        }
+        free(entry);
+    }
+    if(fclose(f) != 0 || rename(temp, path) != 0) {
+        unlink(temp);
+    }
+    free(temp);
+}
+
+// Shared snapshots
+
+/* Name of the shared memory object for the data file filename. It is per
+ * user and word size, so that only compatible processes attach to it.
+ */
+static char *shared_name(const char *filename) {
+    char *name = malloc(strlen(CSV_NAME) + 64);
+
+    sprintf(name, "/distro-info-%s-%ju-%zu-%016jx", CSV_NAME, (uintmax_t)geteuid(),
+            sizeof(size_t) * 8, (uintmax_t)hash_key(filename));
+    return name;
+}
+
+static inline uint32_t shared_abi(void) {
+    return sizeof(size_t) << 16 | sizeof(datekey_t) << 8 | MILESTONE_COUNT;
+}
+
+static bool same_file(const struct stat *stat1, const struct stat *stat2) {
+    return stat1->st_dev == stat2->st_dev && stat1->st_ino == stat2->st_ino &&
+           stat1->st_size == stat2->st_size &&
+           stat1->st_mtim.tv_sec == stat2->st_mtim.tv_sec &&
+           stat1->st_mtim.tv_nsec == stat2->st_mtim.tv_nsec;
+}
+
+static bool shared_tag_matches(const shared_header_t *header,
+                               const struct stat *stat_buf) {
+    return header->dev == (uint64_t)stat_buf->st_dev &&
+           header->ino == (uint64_t)stat_buf->st_ino &&
+           header->file_size == (uint64_t)stat_buf->st_size &&
+           header->mtime == (int64_t)stat_buf->st_mtim.tv_sec &&
+           header->mtime_nsec == (int64_t)stat_buf->st_mtim.tv_nsec;
+}
+
+static inline uint64_t shared_align(uint64_t offset) {
+    return (offset + 7) & ~(uint64_t)7;
+}
+
+// Set the section offsets and the size of header from the section sizes.
+static void shared_layout(shared_header_t *header) {
+    uint64_t offset = shared_align(sizeof(shared_header_t));
+    int milestone_index;
+
+    header->rows = offset;
+    offset = shared_align(offset + header->count * sizeof(shared_row_t));
+    header->dates = offset;
+    offset = shared_align(offset + header->n_dates * sizeof(date_t));
+    header->strings = offset;
+    offset = shared_align(offset + header->strings_size);
+    for(milestone_index = 0; milestone_index < (int)MILESTONE_COUNT;
+        milestone_index++) {
+        header->columns[milestone_index] = offset;
+        offset = shared_align(offset + header->words * ROWS_PER_WORD *
+                              sizeof(datekey_t));
+    }
+    header->versioned = offset;
+    offset += header->words * sizeof(uint64_t);
+    header->lts = offset;
+    offset += header->words * sizeof(uint64_t);
+    header->names = offset;
+    offset = shared_align(offset + header->n_names * sizeof(shared_name_t));
+    header->newest = offset;
+    header->size = offset + header->count * sizeof(size_t);
+}
+
+static uint32_t shared_string(char *strings, uint64_t *used, const char *string) {
+    uint32_t offset = *used;
+    size_t length = strlen(string) + 1;
+
+    memcpy(strings + offset, string, length);
+    *used += length;
+    return offset;
+}
+
+/* Write snapshot of the data file filename (as it was when stat_buf was
+ * taken) to shared memory for other processes. A stale object is removed
+ * first; processes that still have it mapped keep using it. Failures are
+ * ignored, sharing is only an optimization.
+ */
+static void snapshot_share(const snapshot_t *snapshot, const char *filename,
+                           const struct stat *stat_buf, bool stale) {
+    const distro_table_t *table = snapshot->table;
+    shared_header_t layout;
+    shared_header_t *header;
+    shared_row_t *rows;
+    shared_name_t *names;
+    date_t *dates;
+    char *image;
+    char *strings;
+    char *name;
+    uint64_t used = 0;
+    size_t row;
+    int milestone_index;
+    int fd;
+
+    memset(&layout, 0, sizeof(layout));
+    layout.count = table->count;
+    layout.words = table->words;
+    layout.n_names = table->n_names;
+    for(row = 0; row < table->count; row++) {
+        const distro_t *distro = table->rows[row];
+
+        layout.strings_size += strlen(distro->version) + strlen(distro->codename) +
+                               strlen(distro->series) + 3;
+        for(milestone_index = 0; milestone_index < (int)MILESTONE_COUNT;
+            milestone_index++) {
+            layout.n_dates += distro->milestones[milestone_index] != NULL;
+        }
+    }
+    for(row = 0; row < table->n_names; row++) {
+        layout.strings_size += strlen(table->names[row].key) + 1;
+    }
+    if(layout.count >= UINT32_MAX || layout.n_dates >= UINT32_MAX ||
+       layout.strings_size >= UINT32_MAX) {
+        return;
+    }
+    shared_layout(&layout);
+
+    name = shared_name(filename);
+    if(stale) {
+        shm_unlink(name);
+    }
+    fd = shm_open(name, O_RDWR | O_CREAT | O_EXCL, 0600);
+    if(fd < 0) {
+        // Another process is creating it right now.
+        free(name);
+        return;
+    }
+    if(posix_fallocate(fd, 0, layout.size) != 0 ||
+       (image = mmap(NULL, layout.size, PROT_READ | PROT_WRITE, MAP_SHARED,
+                     fd, 0)) == MAP_FAILED) {
+        shm_unlink(name);
+        close(fd);
+        free(name);
+        return;
+    }
+    close(fd);
+    free(name);
+
+    header = (shared_header_t *)image;
+    *header = layout;
+    memcpy(header->magic, SHARED_MAGIC, sizeof(header->magic));
+    header->abi = shared_abi();
+    header->creator = getpid();
+    header->dev = stat_buf->st_dev;
+    header->ino = stat_buf->st_ino;
+    header->file_size = stat_buf->st_size;
+    header->mtime = stat_buf->st_mtim.tv_sec;
+    header->mtime_nsec = stat_buf->st_mtim.tv_nsec;
+
+    rows = (shared_row_t *)(image + layout.rows);
+    dates = (date_t *)(image + layout.dates);
+    strings = image + layout.strings;
+    for(row = 0; row < table->count; row++) {
+        const distro_t *distro = table->rows[row];
+
+        rows[row].version = shared_string(strings, &used, distro->version);
+        rows[row].codename = shared_string(strings, &used, distro->codename);
+        rows[row].series = shared_string(strings, &used, distro->series);
+        for(milestone_index = 0; milestone_index < (int)MILESTONE_COUNT;
+            milestone_index++) {
+            if(distro->milestones[milestone_index] == NULL) {
+                rows[row].milestones[milestone_index] = SHARED_ABSENT;
+            } else {
+                *dates = *distro->milestones[milestone_index];
+                rows[row].milestones[milestone_index] =
+                    dates++ - (date_t *)(image + layout.dates);
+            }
+        }
+    }
+    names = (shared_name_t *)(image + layout.names);
+    for(row = 0; row < table->n_names; row++) {
+        names[row].key = shared_string(strings, &used, table->names[row].key);
+        names[row].row = table->names[row].row;
+    }
+    for(milestone_index = 0; milestone_index < (int)MILESTONE_COUNT;
+        milestone_index++) {
+        memcpy(image + layout.columns[milestone_index], table->columns[milestone_index],
+               table->words * ROWS_PER_WORD * sizeof(datekey_t));
+    }
+    memcpy(image + layout.versioned, table->versioned, table->words * sizeof(uint64_t));
+#ifdef UBUNTU
+    memcpy(image + layout.lts, table->lts, table->words * sizeof(uint64_t));
+#endif
+    memcpy(image + layout.newest, table_newest(table), table->count * sizeof(size_t));
+
+    __atomic_store_n(&header->complete, 1, __ATOMIC_RELEASE);
+    munmap(image, layout.size);
+}
+
+// Check that all references of the shared snapshot in image are in bounds.
+static bool shared_valid(const char *image, const shared_header_t *header) {
+    const shared_row_t *rows = (const shared_row_t *)(image + header->rows);
+    const shared_name_t *names = (const shared_name_t *)(image + header->names);
+    const size_t *newest = (const size_t *)(image + header->newest);
+    const char *strings = image + header->strings;
+    size_t row;
+    int milestone_index;
+
+    if(header->count == 0 || header->count >= UINT32_MAX ||
+       header->n_dates >= UINT32_MAX || header->strings_size >= UINT32_MAX ||
+       header->n_names > 3 * header->count ||
+       header->words != (header->count + ROWS_PER_WORD - 1) / ROWS_PER_WORD ||
+       header->strings_size == 0 || strings[header->strings_size - 1] != '\0') {
+        return false;
+    }
+    for(row = 0; row < header->count; row++) {
+        if(rows[row].version >= header->strings_size ||
+           rows[row].codename >= header->strings_size ||
+           rows[row].series >= header->strings_size || newest[row] >= header->count) {
+            return false;
+        }
+        for(milestone_index = 0; milestone_index < (int)MILESTONE_COUNT;
+            milestone_index++) {
+            if(rows[row].milestones[milestone_index] != SHARED_ABSENT &&
+               rows[row].milestones[milestone_index] >= header->n_dates) {
+                return false;
+            }
+        }
+    }
+    for(row = 0; row < header->n_names; row++) {
+        if(names[row].key >= header->strings_size || names[row].row >= header->count) {
+            return false;
+        }
+    }
+    return true;
+}
+
+/* Attach to the shared snapshot of the data file filename if it matches
+ * stat_buf. Otherwise return NULL and set state to why not: it does not
+ * exist, it is stale (from another version of the data file or left
+ * behind by a crashed process), or another process is still writing it.
+ * The columns, bit sets, newest order, strings, and dates are used in
+ * place. The list, its rows, and the names still have to be built in every
+ * process (O(rows) allocations), because the answer paths walk them as
+ * pointers; their fields point into the shared strings and dates.
+ */
+static snapshot_t *snapshot_attach(const char *filename, const struct stat *stat_buf,
+                                   enum SHARED *state) {
+    struct stat shm_stat;
+    shared_header_t layout;
+    const shared_header_t *header;
+    const shared_row_t *rows;
+    const shared_name_t *names;
+    date_t *dates;
+    char *strings;
+    char *image;
+    char *name;
+    snapshot_t *snapshot;
+    distro_table_t *table;
+    distro_elem_t *list;
+    distro_t *distros;
+    size_t row;
+    int milestone_index;
+    int fd;
+
+    name = shared_name(filename);
+    fd = shm_open(name, O_RDONLY, 0);
+    free(name);
+    if(fd < 0) {
+        *state = errno == ENOENT ? SHARED_MISSING : SHARED_UNAVAILABLE;
+        return NULL;
+    }
+    if(fstat(fd, &shm_stat) != 0 || shm_stat.st_uid != geteuid()) {
+        close(fd);
+        *state = SHARED_UNAVAILABLE;
+        return NULL;
+    }
+    if(shm_stat.st_size < (off_t)sizeof(shared_header_t)) {
+        close(fd);
+        // Not allocated yet, or never will be if its creator is gone.
+        *state = time(NULL) - shm_stat.st_mtime > 60 ? SHARED_STALE : SHARED_BUSY;
+        return NULL;
+    }
+    image = mmap(NULL, shm_stat.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if(image == MAP_FAILED) {
+        *state = SHARED_UNAVAILABLE;
+        return NULL;
+    }
+
+    header = (const shared_header_t *)image;
+    *state = SHARED_STALE;
+    if(memcmp(header->magic, SHARED_MAGIC, sizeof(header->magic)) != 0 ||
+       header->abi != shared_abi()) {
+        munmap(image, shm_stat.st_size);
+        return NULL;
+    }
+    if(!__atomic_load_n(&header->complete, __ATOMIC_ACQUIRE)) {
+        if(kill(header->creator, 0) == 0 || errno != ESRCH) {
+            *state = SHARED_BUSY;
+        }
+        munmap(image, shm_stat.st_size);
+        return NULL;
+    }
+    layout = *header;
+    shared_layout(&layout);
+    if(!shared_tag_matches(header, stat_buf) ||
+       memcmp(&layout, header, sizeof(layout)) != 0 ||
+       header->size != (uint64_t)shm_stat.st_size || !shared_valid(image, header)) {
+        munmap(image, shm_stat.st_size);
+        return NULL;
+    }
+
+    rows = (const shared_row_t *)(image + header->rows);
+    names = (const shared_name_t *)(image + header->names);
+    dates = (date_t *)(image + header->dates);
+    strings = image + header->strings;
+    table = calloc(1, sizeof(distro_table_t));
+    table->count = header->count;
+    table->words = header->words;
+    table->rows = malloc(table->count * sizeof(distro_t *));
+    table->n_names = header->n_names;
+    table->names = malloc(table->n_names * sizeof(name_t));
+    table->newest = (size_t *)(image + header->newest);
+    for(milestone_index = 0; milestone_index < (int)MILESTONE_COUNT;
+        milestone_index++) {
+        table->columns[milestone_index] =
+            (datekey_t *)(image + header->columns[milestone_index]);
+    }
+    table->versioned = (uint64_t *)(image + header->versioned);
+#ifdef UBUNTU
+    table->lts = (uint64_t *)(image + header->lts);
+#endif
+
+    distros = malloc(table->count * sizeof(distro_t));
+    list = malloc(table->count * sizeof(distro_elem_t));
+    for(row = 0; row < table->count; row++) {
+        distros[row].version = strings + rows[row].version;
+        distros[row].codename = strings + rows[row].codename;
+        distros[row].series = strings + rows[row].series;
+        for(milestone_index = 0; milestone_index < (int)MILESTONE_COUNT;
+            milestone_index++) {
+            distros[row].milestones[milestone_index] =
+                rows[row].milestones[milestone_index] == SHARED_ABSENT ? NULL
+                : dates + rows[row].milestones[milestone_index];
+        }
+        list[row].distro = &distros[row];
+        list[row].next = row + 1 < table->count ? &list[row + 1] : NULL;
+        table->rows[row] = &distros[row];
+    }
+    for(row = 0; row < table->n_names; row++) {
+        table->names[row].key = strings + names[row].key;
+        table->names[row].row = names[row].row;
+    }
+
+    snapshot = malloc(sizeof(snapshot_t));
+    snapshot->list = list;
+    snapshot->content = NULL;
+    snapshot->table = table;
+    snapshot->references = 1;
+    snapshot->mapping = image;
+    snapshot->mapping_size = shm_stat.st_size;
+    snapshot->lines = NULL;
+    *state = SHARED_ATTACHED;
+    return snapshot;
+}
+
+/* Attach to the shared snapshot of filename or read the file and share
+ * it, unless another process is doing so right now or the file changed
+ * while it was read.
+ */
+maybe_unused static snapshot_t *snapshot_open_shared(const char *filename) {
+    struct stat before;
+    struct stat after;
+    snapshot_t *snapshot;
+    enum SHARED state;
+
+    if(stat(filename, &before) != 0) {
+        return snapshot_load(filename);
+    }
+    snapshot = snapshot_attach(filename, &before, &state);
+    if(snapshot != NULL) {
+        return snapshot;
+    }
+    snapshot = snapshot_load(filename);
+    if(snapshot != NULL && (state == SHARED_MISSING || state == SHARED_STALE) &&
+       stat(filename, &after) == 0 && same_file(&before, &after)) {
+        snapshot_share(snapshot, filename, &before, state == SHARED_STALE);
+    }
+    return snapshot;
+}
+
+// Versioned data store
+
+#define STORE_MAGIC "distro-info-store 1 " CSV_NAME
+
+/* A versioned data store holds many revisions of the data file in one text
+ * file. It starts with STORE_MAGIC and the CSV header, followed by the
+ * revisions in the order of their dates. Every revision starts with a line
+ * "@ VERSION DATE" and lists the changes to the rows of the revision
+ * before it (the first one to an empty data file), one per line:
+ *
+ *   +AFTER,ROW  insert ROW after the row of series AFTER (at the start if
+ *               AFTER is empty)
+ *   =ROW        replace the row with the series of ROW
+ *   -SERIES     remove the row of SERIES
+ *
+ * A revision is materialized by applying the changes of all revisions up
+ * to it; the revisions after it are not parsed.
+ */
+
+// Series (third column) of a CSV row or NULL if the row has fewer columns.
+static const char *row_series(const char *line, size_t *length) {
+    const char *series = strchr(line, ',');
+
+    if(series == NULL || (series = strchr(series + 1, ',')) == NULL) {
+        return NULL;
+    }
+    series++;
+    *length = strcspn(series, ",");
+    return series;
+}
+
+static void store_init(store_rows_t *rows) {
+    rows->rows = NULL;
+    rows->count = 0;
+    rows->capacity = 0;
+    rows->index_size = 64;
+    rows->index = malloc(rows->index_size * sizeof(size_t));
+    memset(rows->index, 0xff, rows->index_size * sizeof(size_t));
+    rows->head = STORE_END;
+    rows->tail = STORE_END;
+}
+
+static void store_free(store_rows_t *rows) {
+    free(rows->rows);
+    free(rows->index);
+}
+
+// Slot of the index that holds series or the empty slot where it belongs.
+static size_t store_slot(const store_rows_t *rows, const char *series,
+                         size_t length) {
+    size_t slot = hash_bytes(series, length) & (rows->index_size - 1);
+    const store_row_t *row;
+
+    while(rows->index[slot] != STORE_END) {
+        row = &rows->rows[rows->index[slot]];
+        if(row->series_length == length && memcmp(row->series, series, length) == 0) {
+            break;
+        }
+        slot = (slot + 1) & (rows->index_size - 1);
+    }
+    return slot;
+}
+
+// Number of the row of series (even if it was removed) or STORE_END.
+static inline size_t store_lookup(const store_rows_t *rows, const char *series,
+                                  size_t length) {
+    return rows->index[store_slot(rows, series, length)];
+}
+
+static inline bool store_live(const store_rows_t *rows, size_t row) {
+    return row != STORE_END && rows->rows[row].line != NULL;
+}
+
+// Add a new (unlinked) row for series to the index.
+static size_t store_add(store_rows_t *rows, const char *series, size_t length) {
+    size_t *index;
+    size_t i;
+
+    if(2 * (rows->count + 1) > rows->index_size) {
+        index = rows->index;
+        rows->index_size *= 2;
+        rows->index = malloc(rows->index_size * sizeof(size_t));
+        memset(rows->index, 0xff, rows->index_size * sizeof(size_t));
+        for(i = 0; i < rows->count; i++) {
+            rows->index[store_slot(rows, rows->rows[i].series,
+                                   rows->rows[i].series_length)] = i;
+        }
+        free(index);
+    }
+    if(rows->count == rows->capacity) {
+        rows->capacity = rows->capacity ? 2 * rows->capacity : 64;
+        rows->rows = realloc(rows->rows, rows->capacity * sizeof(store_row_t));
+    }
+    rows->index[store_slot(rows, series, length)] = rows->count;
+    rows->rows[rows->count] = (store_row_t){series, length, NULL, STORE_END, STORE_END};
+    return rows->count++;
+}
+
+// Link row after the row after (at the start if after is STORE_END).
+static void store_link(store_rows_t *rows, size_t row, size_t after) {
+    size_t next = after == STORE_END ? rows->head : rows->rows[after].next;
+
+    rows->rows[row].prev = after;
+    rows->rows[row].next = next;
+    if(after == STORE_END) {
+        rows->head = row;
+    } else {
+        rows->rows[after].next = row;
+    }
+    if(next == STORE_END) {
+        rows->tail = row;
+    } else {
+        rows->rows[next].prev = row;
+    }
+}
+
+static void store_unlink(store_rows_t *rows, size_t row) {
+    store_row_t *current = &rows->rows[row];
+
+    if(current->prev == STORE_END) {
+        rows->head = current->next;
+    } else {
+        rows->rows[current->prev].next = current->next;
+    }
+    if(current->next == STORE_END) {
+        rows->tail = current->prev;
+    } else {
+        rows->rows[current->next].prev = current->prev;
+    }
+    current->line = NULL;
+}
+
+// Apply one change (see STORE_MAGIC) to rows.
+static bool store_apply(store_rows_t *rows, const char *change) {
+    const char *line = change + 1;
+    const char *series;
+    size_t length;
+    size_t after = STORE_END;
+    size_t row;
+
+    switch(*change) {
+        case '+':
+            line = strchr(change, ',');
+            if(line == NULL) {
+                return false;
+            }
+            if(line > change + 1) {
+                after = store_lookup(rows, change + 1, line - change - 1);
+                if(!store_live(rows, after)) {
+                    return false;
+                }
+            }
+            series = row_series(++line, &length);
+            if(series == NULL) {
+                return false;
+            }
+            row = store_lookup(rows, series, length);
+            if(store_live(rows, row)) {
+                return false;
+            }
+            if(row == STORE_END) {
+                row = store_add(rows, series, length);
+            }
+            store_link(rows, row, after);
+            break;
+
+        case '=':
+            series = row_series(line, &length);
+            row = series ? store_lookup(rows, series, length) : STORE_END;
+            if(!store_live(rows, row)) {
+                return false;
+            }
+            rows->rows[row].series = series;
+            break;
+
+        case '-':
+            row = store_lookup(rows, line, strlen(line));
+            if(!store_live(rows, row)) {
+                return false;
+            }
+            store_unlink(rows, row);
+            return true;
+
+        default:
+            return false;
+    }
+    rows->rows[row].line = line;
+    return true;
+}
+
+static inline char *next_line(char **data) {
+    char *line = *data;
+    char *end;
+
+    if(line == NULL || *line == '\0') {
+        return NULL;
+    }
+    end = strchr(line, '\n');
+    if(end == NULL) {
+        *data = NULL;
+    } else {
+        *end = '\0';
+        *data = end + 1;
+    }
+    return line;
+}
+
+/* Apply the revisions in content (the store filename) to rows: up to the
+ * revision version if given, the revisions published by as_of if given, or
+ * all. The last applied revision is stored in revision (its version is
+ * NULL if none was applied). The rows point into content.
+ */
+static bool store_read(const char *filename, char *content, const char *version,
+                       const date_t *as_of, store_rows_t *rows,
+                       store_revision_t *revision) {
+    char *data = content;
+    char *line;
+    char *date;
+    date_t revision_date;
+    int lineno = 2;
+
+    revision->version = NULL;
+    line = next_line(&data);
+    if(line == NULL || strcmp(line, STORE_MAGIC) != 0) {
+        fprintf(stderr, NAME ": `%s' is not a data store for " CSV_NAME ".\n",
+                filename);
+        return false;
+    }
+    line = next_line(&data);
+    if(line == NULL || !check_header(line, CSV_HEADER, filename)) {
+        return false;
+    }
+    while((line = next_line(&data)) != NULL) {
+        lineno++;
+        if(*line == '\0' || *line == '#') {
+            continue;
+        }
+        if(*line == '@') {
+            if(revision->version != NULL && version != NULL &&
+               strcmp(revision->version, version) == 0) {
+                break;
+            }
+            date = strrchr(line, ' ');
+            if(strncmp(line, "@ ", 2) != 0 || date == NULL || date < line + 3 ||
+               !parse_date(date + 1, &revision_date)) {
+                fprintf(stderr, NAME ": Invalid revision `%s' in file `%s' at "
+                        "line %i.\n", line, filename, lineno);
+                return false;
+            }
+            if(as_of != NULL && !date_ge(as_of, &revision_date)) {
+                break;
+            }
+            *date = '\0';
+            revision->version = line + 2;
+            revision->date = revision_date;
+        } else if(revision->version == NULL || !store_apply(rows, line)) {
+            fprintf(stderr, NAME ": Invalid change `%s' in file `%s' at line %i.\n",
+                    line, filename, lineno);
+            return false;
+        }
+    }
+    return true;
+}
+
+// Data file (padded like read_full_file()) of the rows.
+static char *store_materialize(const store_rows_t *rows) {
+    size_t size = strlen(CSV_HEADER) + 1;
+    size_t row;
+    char *content;
+    char *end;
+
+    for(row = rows->head; row != STORE_END; row = rows->rows[row].next) {
+        size += strlen(rows->rows[row].line) + 1;
+    }
+    content = malloc(size + CSV_BLOCK);
+    end = stpcpy(content, CSV_HEADER "\n");
+    for(row = rows->head; row != STORE_END; row = rows->rows[row].next) {
+        end = stpcpy(end, rows->rows[row].line);
+        *end++ = '\n';
+    }
+    memset(end, '\0', CSV_BLOCK);
+    return content;
+}
+
+/* Materialize the revision version (or the latest one published by as_of)
+ * of the data store filename into a new snapshot. The publication date of
+ * the revision is stored in published.
+ */
+maybe_unused static snapshot_t *snapshot_load_version(const char *filename,
+                                                      const char *version,
+                                                      const date_t *as_of,
+                                                      date_t *published) {
+    store_revision_t revision;
+    store_rows_t rows;
+    distro_elem_t *distro_list = NULL;
+    char *content;
+    char *data = NULL;
+    char *name;
+    bool success;
+
+    content = read_full_file(filename);
+    if(content == NULL) {
+        return NULL;
+    }
+    store_init(&rows);
+    success = store_read(filename, content, version, as_of, &rows, &revision);
+    if(success && version != NULL &&
+       (revision.version == NULL || strcmp(revision.version, version) != 0)) {
+        fprintf(stderr, NAME ": data version `%s' not found in `%s'.\n", version,
+                filename);
+        success = false;
+    } else if(success && revision.version == NULL) {
+        fprintf(stderr, NAME ": no data version in `%s' was published by "
+                "%04u-%02u-%02u.\n", filename, as_of->year, as_of->month, as_of->day);
+        success = false;
+    }
+    if(success) {
+        *published = revision.date;
+        data = store_materialize(&rows);
+        name = malloc(strlen(filename) + strlen(revision.version) + 20);
+        sprintf(name, "%s (data version %s)", filename, revision.version);
+        distro_list = parse_csv(name, CSV_HEADER, milestones, &data);
+        free(name);
+    }
+    store_free(&rows);
+    free(content);
+    return distro_list ? snapshot_new(distro_list, data) : NULL;
+}
+
+/* Write the changes from rows to the rows of the data file content to
+ * stream. Rows that stay in the same order are kept or replaced; the
+ * others are removed and inserted after the row before them.
+ */
+static bool store_diff(FILE *stream, const char *filename, char *content,
+                       store_rows_t *rows) {
+    size_t *rank = malloc((rows->count + 1) * sizeof(size_t));
+    bool *seen = calloc(rows->count + 1, sizeof(bool));
+    const char *after = "";
+    size_t after_length = 0;
+    size_t last_rank = 0;
+    size_t position = 1;
+    size_t length;
+    size_t row;
+    const char *series;
+    char *line;
+    char *data = content;
+    int lineno = 1;
+    bool success = true;
+
+    for(row = rows->head; row != STORE_END; row = rows->rows[row].next) {
+        rank[row] = position++;
+    }
+    next_line(&data);
+    while((line = next_line(&data)) != NULL) {
+        lineno++;
+        if(*line == '\0' || *line == '#') {
+            continue;
+        }
+        series = row_series(line, &length);
+        row = series ? store_lookup(rows, series, length) : STORE_END;
+        if(series == NULL || (row != STORE_END && seen[row])) {
+            fprintf(stderr, NAME ": Invalid or duplicate row `%s' in file `%s' at "
+                    "line %i.\n", line, filename, lineno);
+            success = false;
+            break;
+        }
+        if(row == STORE_END) {
+            row = store_add(rows, series, length);
+            seen = realloc(seen, rows->count * sizeof(bool));
+            rank = realloc(rank, rows->count * sizeof(size_t));
+        } else if(store_live(rows, row) && rank[row] > last_rank) {
+            if(strcmp(rows->rows[row].line, line) != 0) {
+                fprintf(stream, "=%s\n", line);
+            }
+            last_rank = rank[row];
+            seen[row] = true;
+            after = series;
+            after_length = length;
+            continue;
+        } else if(store_live(rows, row)) {
+            fprintf(stream, "-%.*s\n", (int)length, series);
+        }
+        fprintf(stream, "+%.*s,%s\n", (int)after_length, after, line);
+        seen[row] = true;
+        after = series;
+        after_length = length;
+    }
+    for(row = rows->head; success && row != STORE_END; row = rows->rows[row].next) {
+        if(!seen[row]) {
+            fprintf(stream, "-%.*s\n", (int)rows->rows[row].series_length,
+                    rows->rows[row].series);
+        }
+    }
+    free(rank);
+    free(seen);
+    return success;
+}
+
+/* Read the data file filename, whose header has to match header (older
+ * data files with fewer milestone columns are accepted), and check its
+ * rows. Returns the unparsed content.
+ */
+static char *read_layer(const char *filename, const char *header,
+                        char *const *columns) {
+    distro_elem_t *distro_list;
+    char *content;
+    char *check;
+    size_t size;
+
+    content = read_full_file(filename);
+    if(content == NULL) {
+        return NULL;
+    }
+    size = strcspn(content, "\n");
+    if(size == 0 || (strncmp(content, header, size) != 0 &&
+                     strncmp(content, header, strlen(header)) != 0)) {
+        content[size] = '\0';
+        fprintf(stderr, NAME ": Header `%s' in file `%s' does not start with "
+                "`%s'.\n", content, filename, header);
+        free(content);
+        return NULL;
+    }
+    // The rows are checked with the full header.
+    check = malloc(strlen(header) + strlen(content + size) + CSV_BLOCK + 1);
+    strcpy(stpcpy(check, header), content + size);
+    memset(check + strlen(check), '\0', CSV_BLOCK);
+    distro_list = parse_csv(filename, header, columns, &check);
+    if(distro_list == NULL) {
+        free(content);
+        return NULL;
+    }
+    free_data(distro_list, &check);
+    return content;
+}
+
+/* Add the data file data_file as revision version published on date to the
+ * data store filename (which is created if it does not exist).
+ */
+maybe_unused static bool store_add_version(const char *filename, const char *version,
+                                           const date_t *date, const char *data_file) {
+    store_revision_t revision = {NULL, {0, 0, 0}};
+    store_rows_t rows;
+    char *content = NULL;
+    char *data;
+    char *changes;
+    size_t size;
+    FILE *stream;
+    bool success = true;
+
+    data = read_layer(data_file, CSV_HEADER, milestones);
+    if(data == NULL) {
+        return false;
+    }
+
+    store_init(&rows);
+    if(access(filename, F_OK) == 0) {
+        content = read_full_file(filename);
+        success = content != NULL &&
+                  store_read(filename, content, version, NULL, &rows, &revision);
+    }
+    if(success && revision.version != NULL && strcmp(revision.version, version) == 0) {
+        fprintf(stderr, NAME ": data version `%s' already exists in `%s'.\n",
+                version, filename);
+        success = false;
+    } else if(success && revision.version != NULL && !date_ge(date, &revision.date)) {
+        fprintf(stderr, NAME ": data version `%s' is older than the latest data "
+                "version `%s' in `%s'.\n", version, revision.version, filename);
+        success = false;
+    }
+
+    if(success) {
+        stream = open_memstream(&changes, &size);
+        if(content == NULL) {
+            fprintf(stream, STORE_MAGIC "\n" CSV_HEADER "\n");
+        }
+        fprintf(stream, "@ %s %04u-%02u-%02u\n", version, date->year, date->month,
+                date->day);
+        success = store_diff(stream, data_file, data, &rows);
+        fclose(stream);
+        if(success) {
+            stream = fopen(filename, "a");
+            if(stream == NULL || fputs(changes, stream) == EOF || fclose(stream) != 0) {
+                fprintf(stderr, NAME ": Failed to write %s: %s\n", filename,
+                        strerror(errno));
+                success = false;
+            }
+        }
+        free(changes);
+    }
+    store_free(&rows);
+    free(content);
+    free(data);
+    return success;
+}
+
+// Overlays
+
+static int compare_layer_series(const void *a, const void *b) {
+    const layer_row_t *row1 = a;
+    const layer_row_t *row2 = b;
+    size_t length = row1->series_length < row2->series_length ? row1->series_length
+                                                              : row2->series_length;
+    int result = memcmp(row1->series, row2->series, length);
+
+    if(result != 0) {
+        return result;
+    }
+    return row1->series_length < row2->series_length ? -1
+           : row1->series_length > row2->series_length;
+}
+
+/* Split the content of layer (read by read_layer()) into rows sorted by
+ * series.
+ */
+static bool layer_split(layer_t *layer, const char *filename, size_t index) {
+    char *data = layer->content;
+    char *line;
+    size_t capacity = 64;
+    size_t i;
+
+    layer->rows = malloc(capacity * sizeof(layer_row_t));
+    layer->count = 0;
+    layer->next = 0;
+    next_line(&data);
+    while((line = next_line(&data)) != NULL) {
+        layer_row_t *row;
+
+        if(*line == '\0' || *line == '#') {
+            continue;
+        }
+        if(layer->count == capacity) {
+            capacity *= 2;
+            layer->rows = realloc(layer->rows, capacity * sizeof(layer_row_t));
+        }
+        row = &layer->rows[layer->count];
+        row->series = row_series(line, &row->series_length);
+        if(row->series == NULL) {
+            fprintf(stderr, NAME ": Invalid row `%s' in file `%s'.\n", line, filename);
+            return false;
+        }
+        row->line = line;
+        row->layer = index;
+        row->position = layer->count++;
+    }
+    qsort(layer->rows, layer->count, sizeof(layer_row_t), compare_layer_series);
+    for(i = 1; i < layer->count; i++) {
+        if(compare_layer_series(&layer->rows[i - 1], &layer->rows[i]) == 0) {
+            fprintf(stderr, NAME ": Duplicate series `%.*s' in file `%s'.\n",
+                    (int)layer->rows[i].series_length, layer->rows[i].series,
+                    filename);
+            return false;
+        }
+    }
+    return true;
+}
+
+/* Merge the layers (sorted by series) with a k-way merge: the row of a
+ * series comes from the last layer that has it, but it stays at the place
+ * of its first appearance. The merged rows are sorted by series. Returns
+ * the number of rows.
+ */
+static size_t merge_layers(layer_t *layers, size_t n_layers, layer_row_t *merged) {
+    const layer_row_t *first;
+    const layer_row_t *head;
+    size_t count = 0;
+    size_t i;
+
+    for(;;) {
+        first = NULL;
+        for(i = 0; i < n_layers; i++) {
+            head = &layers[i].rows[layers[i].next];
+            if(layers[i].next < layers[i].count &&
+               (first == NULL || compare_layer_series(head, first) < 0)) {
+                first = head;
+            }
+        }
+        if(first == NULL) {
+            return count;
+        }
+        merged[count] = *first;
+        for(i = 0; i < n_layers; i++) {
+            head = &layers[i].rows[layers[i].next];
+            if(layers[i].next < layers[i].count &&
+               compare_layer_series(head, first) == 0) {
+                merged[count].line = head->line;
+                layers[i].next++;
+            }
+        }
+        count++;
+    }
+}
+
+/* Order the merged rows (see merge_layers()) like the data store orders
+ * inserted rows (see STORE_MAGIC): the rows of the base layer keep their
+ * order, and a series that first appears in an overlay is inserted after
+ * the row before it in that overlay (or appended if it is the first row of
+ * the overlay). Returns the next row of every row (n_rows at the end) and
+ * stores the first row in head.
+ */
+static size_t *order_layers(const layer_t *layers, size_t n_layers,
+                            const layer_row_t *merged, size_t n_rows,
+                            size_t *head) {
+    size_t *next = malloc((n_rows + 1) * sizeof(size_t));
+    const layer_row_t **rows;
+    const layer_row_t *found;
+    size_t tail = n_rows;
+    size_t previous;
+    size_t row;
+    size_t i;
+    size_t j;
+
+    *head = n_rows;
+    for(i = 0; i < n_layers; i++) {
+        rows = malloc((layers[i].count + 1) * sizeof(layer_row_t *));
+        for(j = 0; j < layers[i].count; j++) {
+            rows[layers[i].rows[j].position] = &layers[i].rows[j];
+        }
+        previous = n_rows;
+        for(j = 0; j < layers[i].count; j++) {
+            found = bsearch(rows[j], merged, n_rows, sizeof(layer_row_t),
+                            compare_layer_series);
+            row = found - merged;
+            if(found->layer == i) {
+                if(previous == n_rows || previous == tail) {
+                    next[row] = n_rows;
+                    if(tail == n_rows) {
+                        *head = row;
+                    } else {
+                        next[tail] = row;
+                    }
+                    tail = row;
+                } else {
+                    next[row] = next[previous];
+                    next[previous] = row;
+                }
+            }
+            previous = row;
+        }
+        free(rows);
+    }
+    return next;
+}
+
+// Directory for the merged data files or NULL if there is none.
+static char *overlay_cache_dir(void) {
+    const char *base = getenv("XDG_RUNTIME_DIR");
+    const char *suffix = "/distro-info";
+    char *directory;
+
+    if(base == NULL || *base == '\0') {
+        base = getenv("HOME");
+        suffix = "/.cache/distro-info";
+        if(base == NULL || *base == '\0') {
+            return NULL;
+        }
+    }
+    directory = malloc(strlen(base) + strlen(suffix) + 1);
+    sprintf(directory, "%s%s", base, suffix);
+    return directory;
+}
+
+// Create directory and its missing parents (without reporting errors).
+static bool make_directories(char *directory) {
+    struct stat stat_buf;
+    char *slash;
+
+    for(slash = strchr(directory + 1, '/'); slash != NULL;
+        slash = strchr(slash + 1, '/')) {
+        *slash = '\0';
+        mkdir(directory, 0700);
+        *slash = '/';
+    }
+    return mkdir(directory, 0700) == 0 ||
+           (errno == EEXIST && stat(directory, &stat_buf) == 0 &&
+            S_ISDIR(stat_buf.st_mode));
+}
+
+/* Check whether the merged data file path starts with header and the
+ * identities of its sources (without reading the rows).
+ */
+static bool overlay_cached(const char *path, const char *header,
+                           const char *identity, size_t identity_size) {
+    size_t size = strlen(header) + 1 + identity_size;
+    char *buffer = malloc(size);
+    FILE *f = fopen(path, "r");
+    bool cached;
+
+    cached = f != NULL && fread(buffer, 1, size, f) == size &&
+             strncmp(buffer, header, strlen(header)) == 0 &&
+             buffer[strlen(header)] == '\n' &&
+             memcmp(buffer + strlen(header) + 1, identity, identity_size) == 0;
+    if(f != NULL) {
+        fclose(f);
+    }
+    free(buffer);
+    return cached;
+}
+
+/* Merge the data files sources (the base file first) into a data file that
+ * starts with header and identity. Returns its content (padded like
+ * read_full_file()) and stores its size, or returns NULL on errors.
+ */
+static char *overlay_merge(char **sources, size_t n_sources, const char *header,
+                           char *const *columns, const char *identity,
+                           size_t *size) {
+    layer_t *layers = calloc(n_sources, sizeof(layer_t));
+    layer_row_t *merged;
+    char *output = NULL;
+    size_t *next;
+    size_t n_rows = 0;
+    size_t row;
+    size_t i;
+    FILE *stream;
+    bool success = true;
+
+    for(i = 0; success && i < n_sources; i++) {
+        layers[i].content = read_layer(sources[i], header, columns);
+        success = layers[i].content != NULL && layer_split(&layers[i], sources[i], i);
+        n_rows += layers[i].count;
+    }
+    if(success) {
+        merged = malloc((n_rows + 1) * sizeof(layer_row_t));
+        n_rows = merge_layers(layers, n_sources, merged);
+        next = order_layers(layers, n_sources, merged, n_rows, &row);
+
+        stream = open_memstream(&output, size);
+        fprintf(stream, "%s\n%s", header, identity);
+        for(; row < n_rows; row = next[row]) {
+            fprintf(stream, "%s\n", merged[row].line);
+        }
+        fclose(stream);
+        output = realloc(output, *size + CSV_BLOCK);
+        memset(output + *size, '\0', CSV_BLOCK);
+        free(next);
+        free(merged);
+    }
+    for(i = 0; i < n_sources; i++) {
+        free(layers[i].content);
+        free(layers[i].rows);
+    }
+    free(layers);
+    return output;
+}
+
+/* Return the sources of the data file for the vendor name and store their
+ * number in n_sources: DATA_DIR/name.csv followed by the name.csv files in
+ * the directories listed in DISTRO_INFO_OVERLAYS (separated by colons).
+ */
+static char **overlay_sources(const char *name, size_t *n_sources) {
+    const char *overlays = getenv("DISTRO_INFO_OVERLAYS");
+    char **sources;
+    char *list;
+    char *entry;
+    char *saveptr;
+
+    list = strdup(overlays ? overlays : "");
+    sources = malloc((strlen(list) / 2 + 2) * sizeof(char *));
+    sources[0] = malloc(strlen(DATA_DIR) + strlen(name) + 6);
+    sprintf(sources[0], DATA_DIR "/%s.csv", name);
+    *n_sources = 1;
+    for(entry = strtok_r(list, ":", &saveptr); entry != NULL;
+        entry = strtok_r(NULL, ":", &saveptr)) {
+        sources[*n_sources] = malloc(strlen(entry) + strlen(name) + 6);
+        sprintf(sources[*n_sources], "%s/%s.csv", entry, name);
+        if(access(sources[*n_sources], F_OK) == 0) {
+            (*n_sources)++;
+        } else {
+            free(sources[*n_sources]);
+        }
+    }
+    free(list);
+    return sources;
+}
+
+/* Modification time of the newest source of the data file for the vendor
+ * name (and not of the merged file, which is only rewritten if a source
+ * changed) or the current time if none can be read.
+ */
+maybe_unused static time_t overlay_mtime(const char *name) {
+    struct stat stat_buf;
+    time_t mtime = 0;
+    char **sources;
+    size_t n_sources;
+    size_t i;
+
+    sources = overlay_sources(name, &n_sources);
+    for(i = 0; i < n_sources; i++) {
+        if(stat(sources[i], &stat_buf) == 0 && stat_buf.st_mtime > mtime) {
+            mtime = stat_buf.st_mtime;
+        }
+        free(sources[i]);
+    }
+    free(sources);
+    return mtime > 0 ? mtime : time(NULL);
+}
+
+/* Return the data file for the vendor name (with the given header and
+ * milestone columns): DATA_DIR/name.csv or, if the directories listed in
+ * DISTRO_INFO_OVERLAYS (separated by colons) contain name.csv files, a
+ * merged data file in which the overlays override or extend the rows of
+ * the base file by series. The merged file is cached together with the
+ * identities (device, inode, size, and modification time) of its sources
+ * and only merged again if one of them changed. If it cannot be cached,
+ * the merged data is stored in merged (padded like read_full_file()) and
+ * the returned name is only meant for messages; otherwise merged is set
+ * to NULL. Returns NULL on errors.
+ */
+maybe_unused static char *overlay_data_file(const char *name, const char *header,
+                                            char *const *columns, char **merged) {
+    char **sources;
+    size_t n_sources;
+    struct stat stat_buf;
+    char *directory;
+    char *identity;
+    char *path = NULL;
+    size_t identity_size;
+    uint64_t hash;
+    size_t i;
+    FILE *stream;
+    char *content;
+    size_t size;
+    bool success = true;
+
+    *merged = NULL;
+    sources = overlay_sources(name, &n_sources);
+    if(n_sources == 1) {
+        // Without overlays (errors are reported when it is read).
+        path = sources[0];
+        free(sources);
+        return path;
+    }
+
+    /* The identities of the sources follow the header as comments, after
+     * the version of the merge, so that merged files of an older order are
+     * merged again.
+     */
+    stream = open_memstream(&identity, &identity_size);
+    fprintf(stream, "# merge 2\n");
+    hash = hash_bytes(name, strlen(name));
+    for(i = 0; success && i < n_sources; i++) {
+        if(stat(sources[i], &stat_buf) != 0) {
+            fprintf(stderr, NAME ": Failed to open %s: %s\n", sources[i],
+                    strerror(errno));
+            success = false;
+        } else {
+            fprintf(stream, "# %s %ju:%ju:%jd:%jd.%09ld\n", sources[i],
+                    (uintmax_t)stat_buf.st_dev, (uintmax_t)stat_buf.st_ino,
+                    (intmax_t)stat_buf.st_size, (intmax_t)stat_buf.st_mtim.tv_sec,
+                    stat_buf.st_mtim.tv_nsec);
+        }
+        hash = (hash ^ hash_bytes(sources[i], strlen(sources[i]))) *
+               UINT64_C(1099511628211);
+    }
+    fclose(stream);
+
+    directory = overlay_cache_dir();
+    if(success && directory != NULL) {
+        path = malloc(strlen(directory) + strlen(name) + 24);
+        sprintf(path, "%s/%s-%016jx.csv", directory, name, (uintmax_t)hash);
+    }
+    if(success && (path == NULL ||
+                   !overlay_cached(path, header, identity, identity_size))) {
+        content = overlay_merge(sources, n_sources, header, columns, identity,
+                                &size);
+        success = content != NULL;
+        if(success && (path == NULL || !make_directories(directory) ||
+                       !write_atomically(path, content, size, false))) {
+            // Without a writable cache, the merged data is parsed from memory.
+            free(path);
+            path = malloc(strlen(sources[0]) + 32);
+            sprintf(path, "%s (with DISTRO_INFO_OVERLAYS)", sources[0]);
+            *merged = content;
+        } else {
+            free(content);
+        }
+    }
+
+    free(identity);
+    free(directory);
+    for(i = 0; i < n_sources; i++) {
+        free(sources[i]);
+    }
+    free(sources);
+    if(!success) {
+        free(path);
+        return NULL;
+    }
+    return path;
+}
+
+// Incremental reload
+
+/* Store the byte range and hash of every row of content (which is not
+ * tokenized yet) in lines, in the order in which parse_csv() reads the
+ * rows. Returns the number of rows.
+ */
+static size_t scan_lines(const char *content, row_line_t **lines) {
+    const char *end = content + strlen(content);
+    const char *data = memchr(content, '\n', end - content);
+    const char *newline;
+    size_t capacity = 64;
+    size_t count = 0;
+    size_t length;
+
+    *lines = malloc(capacity * sizeof(row_line_t));
+    if(data == NULL) {
+        return 0;
+    }
+    for(data++; data < end; data += length + 1) {
+        newline = memchr(data, '\n', end - data);
+        length = newline ? (size_t)(newline - data) : (size_t)(end - data);
+        // Like read_row(), skip empty lines and comments.
+        if(length == 0 || *data == '#') {
+            continue;
+        }
+        if(count == capacity) {
+            capacity *= 2;
+            *lines = realloc(*lines, capacity * sizeof(row_line_t));
+        }
+        (*lines)[count++] = (row_line_t){data - content, length,
+                                         hash_bytes(data, length)};
+    }
+    return count;
+}
+
+/* Read filename into a new snapshot that holds one reference and that
+ * keeps the lines of its rows for snapshot_reload().
+ */
+static snapshot_t *snapshot_read(const char *filename) {
+    distro_elem_t *distro_list;
+    snapshot_t *snapshot;
+    row_line_t *lines;
+    char *content;
+
+    content = read_full_file(filename);
+    if(unlikely(content == NULL)) {
+        return NULL;
+    }
+    scan_lines(content, &lines);
+    distro_list = parse_csv(filename, CSV_HEADER, milestones, &content);
+    if(unlikely(distro_list == NULL)) {
+        free(lines);
+        return NULL;
+    }
+    snapshot = snapshot_new(distro_list, content);
+    snapshot->lines = lines;
+    return snapshot;
+}
+
+/* Whether the line at new (not tokenized) is the same as the tokenized
+ * line at old, in which read_row() replaced the separators by zeros.
+ */
+static bool same_line(const char *old, const char *new, size_t length) {
+    size_t i;
+
+    for(i = 0; i < length; i++) {
+        if(old[i] != new[i] && (old[i] != '\0' || new[i] != ',')) {
+            return false;
+        }
+    }
+    return true;
+}
+
+static inline char *rebase(const char *string, const char *old, char *new) {
+    return string ? new + (string - old) : NULL;
+}
+
+/* Copy the row distro that was read from the line at old to the same line
+ * at new, which is tokenized like read_row() would do.
+ */
+static distro_t *copy_row(const distro_t *distro, const char *old, char *new,
+                          size_t length) {
+    distro_t *copy = malloc(sizeof(distro_t));
+    int milestone_index;
+    size_t i;
+
+    for(i = 0; i < length; i++) {
+        if(new[i] == ',') {
+            new[i] = '\0';
+        }
+    }
+    new[length] = '\0';
+    copy->version = rebase(distro->version, old, new);
+    copy->codename = rebase(distro->codename, old, new);
+    copy->series = rebase(distro->series, old, new);
+    for(milestone_index = 0; milestone_index < (int)MILESTONE_COUNT;
+        milestone_index++) {
+        if(distro->milestones[milestone_index] == NULL) {
+            copy->milestones[milestone_index] = NULL;
+        } else {
+            copy->milestones[milestone_index] = malloc(sizeof(date_t));
+            *copy->milestones[milestone_index] = *distro->milestones[milestone_index];
+        }
+    }
+    return copy;
+}
+
+/* Row of previous whose line is the same as the line at line (not
+ * tokenized) or SIZE_MAX. index holds the rows of previous by the hash of
+ * their lines.
+ */
+static size_t find_line(const snapshot_t *previous, const size_t *index,
+                        size_t index_size, const row_line_t *line,
+                        const char *content) {
+    const row_line_t *candidate;
+    size_t slot = line->hash & (index_size - 1);
+
+    for(; index[slot] != SIZE_MAX; slot = (slot + 1) & (index_size - 1)) {
+        candidate = &previous->lines[index[slot]];
+        if(candidate->hash == line->hash && candidate->length == line->length &&
+           same_line(previous->content + candidate->offset,
+                     content + line->offset, line->length)) {
+            return index[slot];
+        }
+    }
+    return SIZE_MAX;
+}
+
+/* Map every row of lines to the row of previous with the same line (or
+ * SIZE_MAX if there is none).
+ */
+static size_t *match_lines(const snapshot_t *previous, const row_line_t *lines,
+                           size_t count, const char *content) {
+    size_t *origin = malloc((count ? count : 1) * sizeof(size_t));
+    size_t index_size = 64;
+    size_t *index;
+    size_t slot;
+    size_t row;
+
+    while(index_size < 2 * previous->table->count) {
+        index_size *= 2;
+    }
+    index = malloc(index_size * sizeof(size_t));
+    memset(index, 0xff, index_size * sizeof(size_t));
+    for(row = 0; row < previous->table->count; row++) {
+        slot = previous->lines[row].hash & (index_size - 1);
+        while(index[slot] != SIZE_MAX) {
+            slot = (slot + 1) & (index_size - 1);
+        }
+        index[slot] = row;
+    }
+    for(row = 0; row < count; row++) {
+        origin[row] = find_line(previous, index, index_size, &lines[row], content);
+    }
+    free(index);
+    return origin;
+}
+
+/* Table of distro_list whose rows come from the rows origin of previous
+ * (or SIZE_MAX for new rows). The names and the newest order of the kept
+ * rows are taken over from previous and merged with those of the new rows,
+ * unless the kept rows changed their order. If previous has no newest
+ * order yet, neither has the new table.
+ */
+static distro_table_t *patch_table(const distro_table_t *previous,
+                                   const distro_elem_t *distro_list,
+                                   const size_t *origin) {
+    distro_table_t *table = table_columns(distro_list);
+    distro_table_t fresh = {0};
+    newest_key_t *newest;
+    newest_key_t kept;
+    name_t name;
+    size_t *target = malloc((previous->count ? previous->count : 1) * sizeof(size_t));
+    size_t n_fresh = 0;
+    size_t last = SIZE_MAX;
+    size_t row;
+    size_t i;
+    size_t j;
+
+    memset(target, 0xff, previous->count * sizeof(size_t));
+    for(row = 0; row < table->count; row++) {
+        if(origin[row] == SIZE_MAX) {
+            n_fresh++;
+        } else if(last != SIZE_MAX && origin[row] <= last) {
+            // Moved rows would change the order of equal names.
+            free(target);
+            free_table(table);
+            return build_table(distro_list);
+        } else {
+            target[origin[row]] = row;
+            last = origin[row];
+        }
+    }
+
+    fresh.names = malloc((3 * n_fresh + 1) * sizeof(name_t));
+    newest = malloc((n_fresh + 1) * sizeof(newest_key_t));
+    for(row = 0; row < table->count; row++) {
+        if(origin[row] == SIZE_MAX) {
+            add_names(&fresh, table->rows[row], row);
+            if(previous->newest != NULL) {
+                newest_key(table, row, &newest[fresh.count++]);
+            }
+        }
+    }
+    qsort(fresh.names, fresh.n_names, sizeof(name_t), compare_names);
+    qsort(newest, fresh.count, sizeof(newest_key_t), compare_newest);
+
+    // Merge the kept names (with their new rows) with the new names.
+    for(i = 0, j = 0; i < previous->n_names; i++) {
+        if(target[previous->names[i].row] == SIZE_MAX) {
+            continue;
+        }
+        name = (name_t){previous->names[i].key, target[previous->names[i].row]};
+        while(j < fresh.n_names && compare_names(&fresh.names[j], &name) < 0) {
+            table->names[table->n_names++] = fresh.names[j++];
+        }
+        name.key = strdup(name.key);
+        table->names[table->n_names++] = name;
+    }
+    while(j < fresh.n_names) {
+        table->names[table->n_names++] = fresh.names[j++];
+    }
+
+    if(previous->newest != NULL) {
+        table->newest = malloc((table->count + 1) * sizeof(size_t));
+    }
+    for(i = 0, j = 0, row = 0; table->newest != NULL && i < previous->count; i++) {
+        if(target[previous->newest[i]] == SIZE_MAX) {
+            continue;
+        }
+        newest_key(table, target[previous->newest[i]], &kept);
+        while(j < fresh.count && compare_newest(&newest[j], &kept) < 0) {
+            table->newest[row++] = newest[j++].row;
+        }
+        table->newest[row++] = kept.row;
+    }
+    while(table->newest != NULL && j < fresh.count) {
+        table->newest[row++] = newest[j++].row;
+    }
+
+    free(newest);
+    free(fresh.names);
+    free(target);
+    return table;
+}
+
+/* Store the series of the rows that were added, changed, or removed in
+ * reload: a new row whose series was in one of the rows of previous that
+ * were not kept is a changed row.
+ */
+static void report_changes(const snapshot_t *previous, const snapshot_t *snapshot,
+                           const size_t *origin, reload_t *reload) {
+    store_rows_t dropped;
+    const char *series;
+    bool *kept = calloc(previous->table->count + 1, sizeof(bool));
+    size_t row;
+    size_t match;
+
+    reload->changes = NULL;
+    reload->count = 0;
+    reload->reused = 0;
+    store_init(&dropped);
+    for(row = 0; row < snapshot->table->count; row++) {
+        if(origin[row] != SIZE_MAX) {
+            kept[origin[row]] = true;
+            reload->reused++;
+        }
+    }
+    for(row = 0; row < previous->table->count; row++) {
+        series = previous->table->rows[row]->series;
+        if(!kept[row] && series != NULL) {
+            store_add(&dropped, series, strlen(series));
+        }
+    }
+    reload->changes = malloc((snapshot->table->count - reload->reused + dropped.count + 1) *
+                             sizeof(series_change_t));
+    for(row = 0; row < snapshot->table->count; row++) {
+        series = snapshot->table->rows[row]->series;
+        if(origin[row] != SIZE_MAX || series == NULL) {
+            continue;
+        }
+        match = store_lookup(&dropped, series, strlen(series));
+        if(match != STORE_END) {
+            // Marks the dropped row as changed.
+            dropped.rows[match].line = series;
+        }
+        reload->changes[reload->count++] =
+            (series_change_t){match != STORE_END ? '=' : '+', strdup(series)};
+    }
+    for(row = 0; row < dropped.count; row++) {
+        if(dropped.rows[row].line == NULL) {
+            reload->changes[reload->count++] =
+                (series_change_t){'-', strdup(dropped.rows[row].series)};
+        }
+    }
+    store_free(&dropped);
+    free(kept);
+}
+
+maybe_unused static void free_reload(reload_t *reload) {
+    size_t i;
+
+    for(i = 0; i < reload->count; i++) {
+        free(reload->changes[i].series);
+    }
+    free(reload->changes);
+}
+
+/* Read filename again as the successor of previous (which has the lines of
+ * its rows): the rows whose lines did not change are copied from previous
+ * and only the others are parsed. Returns NULL on errors.
+ */
+static snapshot_t *snapshot_update(const snapshot_t *previous, const char *filename,
+                                   reload_t *reload) {
+    row_parser_t parser = {filename, milestones, NULL, false, 0};
+    distro_elem_t *distro_list = NULL;
+    distro_elem_t **last = &distro_list;
+    distro_elem_t *current;
+    snapshot_t *snapshot;
+    csv_reader_t reader;
+    row_line_t *lines;
+    size_t *origin;
+    size_t count;
+    size_t row;
+    size_t end;
+    size_t i;
+    int lineno = 1;
+    char *content;
+    char *line;
+    char *field;
+    char separator;
+
+    content = read_full_file(filename);
+    if(unlikely(content == NULL)) {
+        return NULL;
+    }
+    count = scan_lines(content, &lines);
+    origin = match_lines(previous, lines, count, content);
+    end = strcspn(content, "\n");
+    content[end] = '\0';
+    if(!check_header(content, CSV_HEADER, filename)) {
+        parser.failures++;
+    }
+
+    for(row = 0; row < count; row++) {
+        // Only empty lines and comments, which are not tokenized, lie between rows.
+        for(i = end + 1, lineno++; i < lines[row].offset; i++) {
+            lineno += content[i] == '\n';
+        }
+        end = lines[row].offset + lines[row].length;
+        line = content + lines[row].offset;
+        current = malloc(sizeof(distro_elem_t));
+        current->next = NULL;
+        *last = current;
+        last = &current->next;
+        if(origin[row] != SIZE_MAX) {
+            current->distro = copy_row(previous->table->rows[origin[row]],
+                                       previous->content + previous->lines[origin[row]].offset,
+                                       line, lines[row].length);
+        } else {
+            // The line ends at its newline or at the end of the data.
+            csv_start(&reader, line, line + lines[row].length + 1);
+            field = csv_field(&reader, &separator);
+            current->distro = read_row(&reader, field, &separator, &parser, lineno);
+        }
+    }
+    if(unlikely(distro_list == NULL)) {
+        fprintf(stderr, NAME ": No data found in file `%s'.\n", filename);
+        parser.failures++;
+    }
+    if(unlikely(parser.failures > 0)) {
+        free_data(distro_list, &content);
+        free(lines);
+        free(origin);
+        return NULL;
+    }
+
+    snapshot = snapshot_wrap(distro_list, content,
+                             patch_table(previous->table, distro_list, origin));
+    snapshot->lines = lines;
+    if(reload != NULL) {
+        report_changes(previous, snapshot, origin, reload);
+    }
+    free(origin);
+    return snapshot;
+}
+
+/* Load filename off to the side and publish it in store. If the published
+ * snapshot has the lines of its rows (see snapshot_read()), only the rows
+ * that changed are parsed again. The series that changed are stored in
+ * reload (if it is not NULL), which has to be freed with free_reload().
+ * The published snapshot stays in place if the file cannot be read.
+ */
+maybe_unused static bool snapshot_reload(snapshot_store_t *store, const char *filename,
+                                         reload_t *reload) {
+    snapshot_t *previous = snapshot_acquire(store);
+    snapshot_t *snapshot;
+
+    if(previous != NULL && previous->lines != NULL) {
+        snapshot = snapshot_update(previous, filename, reload);
+    } else {
+        snapshot = snapshot_read(filename);
+        if(snapshot != NULL && reload != NULL) {
+            *reload = (reload_t){NULL, 0, 0};
+        }
+    }
+    snapshot_release(previous);
+    if(snapshot == NULL) {
+        return false;
+    }
+    snapshot_publish(store, snapshot);
+    return true;
+}
+
+// Semantic diff
+
+#define DIFF_FILTER(name) &filter_##name,
+
+// Filters of the options that list versions
+static const filter_t *const diff_filters[] = {
+    KERNEL_FILTERS(DIFF_FILTER)
+};
+
+#define DIFF_FILTER_COUNT (sizeof(diff_filters) / sizeof(diff_filters[0]))
+#define DIFF_SELECT_END (DIFF_FILTER_COUNT + SELECT_KERNEL_COUNT)
+#ifdef UBUNTU
+// --latest is the devel selection with the stable selection as fallback.
+#define DIFF_QUERY_COUNT (DIFF_SELECT_END + 1)
+#else
+#define DIFF_QUERY_COUNT DIFF_SELECT_END
+#endif
+
+static inline bool same_text(const char *a, const char *b) {
+    return a == b || (a != NULL && b != NULL && strcmp(a, b) == 0);
+}
+
+/* Bit set of the list filters for which the rows of unit are listed
+ * differently by the two data files.
+ */
+static unsigned int unit_mismatches(const diff_t *diff, size_t unit) {
+    unsigned int mismatches = 0;
+    size_t row;
+    size_t i;
+    int side;
+    bool listed[2];
+
+    for(i = 0; i < DIFF_FILTER_COUNT; i++) {
+        for(side = 0; side < 2; side++) {
+            row = diff->unit_rows[side][unit];
+            listed[side] = row != SIZE_MAX &&
+                           accepts(diff_filters[i], diff->sides[side].predicates[row]);
+        }
+        if(listed[0] != listed[1] || (listed[0] && !diff->same_names[unit])) {
+            mismatches |= 1U << i;
+        }
+    }
+    return mismatches;
+}
+
+// Set the predicates of row of side and update the filter and selector state.
+static void diff_update(diff_t *diff, int side, size_t row,
+                        unsigned int predicates) {
+    const size_t unit = diff->units[side][row];
+    unsigned int before;
+    unsigned int after;
+    size_t i;
+
+    if(predicates == diff->sides[side].predicates[row]) {
+        return;
+    }
+    before = unit_mismatches(diff, unit);
+    sweep_update(&diff->sides[side], row, predicates);
+    after = unit_mismatches(diff, unit);
+    for(i = 0; i < DIFF_FILTER_COUNT; i++) {
+        if(((before ^ after) >> i) & 1) {
+            if((after >> i) & 1) {
+                diff->mismatches[i]++;
+            } else {
+                diff->mismatches[i]--;
+            }
+        }
+    }
+}
+
+// Name of query: the name of its filter
+static inline const char *diff_query_name(size_t query) {
+    if(query >= DIFF_SELECT_END) {
+        return "latest";
+    }
+    return query < DIFF_FILTER_COUNT ? diff_filters[query]->name
+                                     : select_kernels[query - DIFF_FILTER_COUNT].filter->name;
+}
+
+// Row of side that the selecting query selects at the current date.
+static size_t diff_selected(const diff_t *diff, int side, size_t query) {
+    size_t row;
+
+    if(query < DIFF_SELECT_END) {
+        return sweep_selected(&diff->sides[side], query - DIFF_FILTER_COUNT);
+    }
+#ifdef UBUNTU
+    row = sweep_selected(&diff->sides[side],
+                         select_kernel_index(&filter_devel, select_latest_created));
+    if(row == SIZE_MAX) {
+        row = sweep_selected(&diff->sides[side],
+                             select_kernel_index(&filter_stable, select_latest_release));
+    }
+#else
+    row = SIZE_MAX;
+#endif
+    return row;
+}
+
+// Whether the answers to query differ at the current date of the sweep.
+static bool diff_differs(const diff_t *diff, size_t query) {
+    const distro_t *distros[2];
+    size_t row;
+    int side;
+
+    if(query < DIFF_FILTER_COUNT) {
+        return diff->mismatches[query] > 0;
+    }
+    for(side = 0; side < 2; side++) {
+        row = diff_selected(diff, side, query);
+        distros[side] = row == SIZE_MAX ? NULL : diff->sides[side].table->rows[row];
+    }
+    if(distros[0] == NULL || distros[1] == NULL) {
+        return distros[0] != distros[1];
+    }
+    return !same_text(distros[0]->series, distros[1]->series) ||
+           !same_text(distros[0]->version, distros[1]->version) ||
+           !same_text(distros[0]->codename, distros[1]->codename);
+}
+
+/* Pair the rows of both data files by series. Rows whose series only one
+ * file has get a unit of their own.
+ */
+static void diff_units(diff_t *diff) {
+    const distro_table_t *old = diff->sides[0].table;
+    const distro_table_t *new = diff->sides[1].table;
+    store_rows_t index;
+    size_t unit;
+    size_t row;
+    size_t match;
+
+    diff->units[0] = malloc((old->count + 1) * sizeof(size_t));
+    diff->units[1] = malloc((new->count + 1) * sizeof(size_t));
+    diff->unit_rows[0] = malloc((old->count + new->count + 1) * sizeof(size_t));
+    diff->unit_rows[1] = malloc((old->count + new->count + 1) * sizeof(size_t));
+    diff->same_names = malloc((old->count + new->count + 1) * sizeof(bool));
+    store_init(&index);
+    for(row = 0; row < old->count; row++) {
+        store_add(&index, old->rows[row]->series, strlen(old->rows[row]->series));
+        diff->units[0][row] = SIZE_MAX;
+    }
+    for(unit = 0; unit < new->count; unit++) {
+        match = store_lookup(&index, new->rows[unit]->series,
+                             strlen(new->rows[unit]->series));
+        if(match != STORE_END && diff->units[0][match] != SIZE_MAX) {
+            // The series is listed twice in the new file.
+            match = STORE_END;
+        }
+        diff->unit_rows[0][unit] = match == STORE_END ? SIZE_MAX : match;
+        diff->unit_rows[1][unit] = unit;
+        diff->same_names[unit] = match != STORE_END &&
+                                 same_text(old->rows[match]->version,
+                                           new->rows[unit]->version) &&
+                                 same_text(old->rows[match]->codename,
+                                           new->rows[unit]->codename);
+        diff->units[1][unit] = unit;
+        if(match != STORE_END) {
+            diff->units[0][match] = unit;
+        }
+    }
+    for(row = 0; row < old->count; row++) {
+        if(diff->units[0][row] == SIZE_MAX) {
+            diff->unit_rows[0][unit] = row;
+            diff->unit_rows[1][unit] = SIZE_MAX;
+            diff->same_names[unit] = false;
+            diff->units[0][row] = unit++;
+        }
+    }
+    diff->n_units = unit;
+    store_free(&index);
+}
+
+static void print_value(FILE *stream, const char *value) {
+    fprintf(stream, "\t%s", value ? value : "-");
+}
+
+static void print_key(FILE *stream, datekey_t key) {
+    date_t date = key_to_date(key);
+
+    if(key == DATEKEY_ABSENT) {
+        fputs("\t-", stream);
+    } else {
+        fprintf(stream, "\t%04u-%02u-%02u", date.year, date.month, date.day);
+    }
+}
+
+/* Print one line "series field old new" for every field of the rows of
+ * unit that differs ("-" for the side that does not have the row).
+ */
+static void print_unit_changes(FILE *stream, const diff_t *diff, size_t unit) {
+    const distro_t *distros[2];
+    const distro_table_t *tables[2];
+    const distro_t *named;
+    size_t rows[2];
+    int milestone_index;
+    int side;
+
+    for(side = 0; side < 2; side++) {
+        tables[side] = diff->sides[side].table;
+        rows[side] = diff->unit_rows[side][unit];
+        distros[side] = rows[side] == SIZE_MAX ? NULL : tables[side]->rows[rows[side]];
+    }
+    named = distros[1] ? distros[1] : distros[0];
+    if(distros[0] == NULL || distros[1] == NULL ||
+       !same_text(distros[0]->version, distros[1]->version)) {
+        fprintf(stream, "%s\tversion", named->series);
+        print_value(stream, distros[0] ? distros[0]->version : NULL);
+        print_value(stream, distros[1] ? distros[1]->version : NULL);
+        fputc('\n', stream);
+    }
+    if(distros[0] == NULL || distros[1] == NULL ||
+       !same_text(distros[0]->codename, distros[1]->codename)) {
+        fprintf(stream, "%s\tcodename", named->series);
+        print_value(stream, distros[0] ? distros[0]->codename : NULL);
+        print_value(stream, distros[1] ? distros[1]->codename : NULL);
+        fputc('\n', stream);
+    }
+    for(milestone_index = 0; milestone_index < (int)MILESTONE_COUNT;
+        milestone_index++) {
+        datekey_t keys[2];
+
+        for(side = 0; side < 2; side++) {
+            keys[side] = distros[side]
+                         ? tables[side]->columns[milestone_index][rows[side]]
+                         : DATEKEY_ABSENT;
+        }
+        if(keys[0] != keys[1]) {
+            fprintf(stream, "%s\t%s", named->series, milestones[milestone_index]);
+            print_key(stream, keys[0]);
+            print_key(stream, keys[1]);
+            fputc('\n', stream);
+        }
+    }
+}
+
+// Count the units that every list filter shows differently.
+static void diff_start(diff_t *diff) {
+    unsigned int mismatches;
+    size_t unit;
+    size_t i;
+
+    for(unit = 0; unit < diff->n_units; unit++) {
+        mismatches = unit_mismatches(diff, unit);
+        for(i = 0; i < DIFF_FILTER_COUNT; i++) {
+            diff->mismatches[i] += (mismatches >> i) & 1;
+        }
+    }
+}
+
+/* Apply all events of side on key to the predicates of their rows. */
+static void diff_advance(diff_t *diff, int side, datekey_t key) {
+    sweep_t *sweep = &diff->sides[side];
+    size_t row;
+
+    while(sweep_next(sweep) == key) {
+        row = sweep->events[sweep->next++].row;
+        diff_update(diff, side, row, table_row_predicates(sweep->table, row, key));
+    }
+}
+
+static void previous_day(date_t *date) {
+    if(date->day > 1) {
+        date->day--;
+    } else if(date->month > 1) {
+        date->month--;
+        date->day = is_leap_year(date->year) && date->month == 2
+                    ? 29 : days_in_month[date->month - 1];
+    } else {
+        date->year--;
+        date->month = 12;
+        date->day = 31;
+    }
+}
+
+// Print the range of dates from start (0: all before) to the day before end.
+static void print_range(FILE *stream, const char *name, datekey_t start,
+                        datekey_t end) {
+    date_t last;
+
+    fputs(name, stream);
+    if(start == 0) {
+        fputs("\t-", stream);
+    } else {
+        print_key(stream, start);
+    }
+    if(end == DATEKEY_ABSENT) {
+        fputs("\t-\n", stream);
+    } else {
+        last = key_to_date(end);
+        previous_day(&last);
+        print_key(stream, date_to_key(&last));
+        fputc('\n', stream);
+    }
+}
+
+/* Print the fields that differ between the data files old_file and
+ * new_file (by series) and, for every filter and selector of the options
+ * that list or select versions, the ranges of dates on which the answers
+ * (without days) differ. The answers only change on milestone dates, so
+ * the sweep goes once through the merged milestone dates of both files and
+ * only updates the rows that have a milestone on that date.
+ */
+maybe_unused static bool print_diff(FILE *stream, const char *old_file, const char *new_file) {
+    snapshot_t *snapshots[2] = {snapshot_load(old_file), NULL};
+    diff_t diff;
+    datekey_t since[DIFF_QUERY_COUNT];
+    datekey_t key = 0;
+    FILE *ranges[DIFF_QUERY_COUNT];
+    char *buffers[DIFF_QUERY_COUNT];
+    size_t sizes[DIFF_QUERY_COUNT];
+    size_t query;
+    size_t unit;
+    int side;
+
+    if(snapshots[0] == NULL || (snapshots[1] = snapshot_load(new_file)) == NULL) {
+        snapshot_release(snapshots[0]);
+        return false;
+    }
+    for(side = 0; side < 2; side++) {
+        sweep_init(&diff.sides[side], snapshots[side]->table, 0, kernel_selectors,
+                   SELECT_KERNEL_COUNT, table_row_predicates);
+    }
+    diff_units(&diff);
+    diff.mismatches = calloc(DIFF_FILTER_COUNT, sizeof(size_t));
+
+    fprintf(stream, "series\tfield\told\tnew\n");
+    for(unit = 0; unit < diff.n_units; unit++) {
+        print_unit_changes(stream, &diff, unit);
+    }
+
+    diff_start(&diff);
+    for(query = 0; query < DIFF_QUERY_COUNT; query++) {
+        ranges[query] = open_memstream(&buffers[query], &sizes[query]);
+        since[query] = diff_differs(&diff, query) ? 0 : DATEKEY_ABSENT;
+    }
+    for(;;) {
+        key = sweep_next(&diff.sides[0]) < sweep_next(&diff.sides[1])
+              ? sweep_next(&diff.sides[0]) : sweep_next(&diff.sides[1]);
+        if(key == DATEKEY_ABSENT) {
+            break;
+        }
+        diff_advance(&diff, 0, key);
+        diff_advance(&diff, 1, key);
+        for(query = 0; query < DIFF_QUERY_COUNT; query++) {
+            bool differs = diff_differs(&diff, query);
+
+            if(differs && since[query] == DATEKEY_ABSENT) {
+                since[query] = key;
+            } else if(!differs && since[query] != DATEKEY_ABSENT) {
+                print_range(ranges[query], diff_query_name(query), since[query], key);
+                since[query] = DATEKEY_ABSENT;
+            }
+        }
+    }
+
+    fprintf(stream, "\nquery\tfrom\tuntil\n");
+    for(query = 0; query < DIFF_QUERY_COUNT; query++) {
+        if(since[query] != DATEKEY_ABSENT) {
+            print_range(ranges[query], diff_query_name(query), since[query],
+                        DATEKEY_ABSENT);
+        }
+        fclose(ranges[query]);
+        fputs(buffers[query], stream);
+        free(buffers[query]);
+    }
+
+    for(side = 0; side < 2; side++) {
+        sweep_free(&diff.sides[side]);
+        free(diff.units[side]);
+        free(diff.unit_rows[side]);
+        snapshot_release(snapshots[side]);
+    }
+    free(diff.same_names);
+    free(diff.mismatches);
+    return !ferror(stream);
+}
+
+// First date of the interval between two milestones that contains date.
+maybe_unused static datekey_t interval_start(const distro_table_t *table, const date_t *date) {
+    const datekey_t key = date_to_key(date);
+    datekey_t *events;
+    datekey_t start = 0;
+    size_t n_events;
+    size_t i;
+
+    n_events = milestone_events(table, &events);
+    for(i = 0; i < n_events && events[i] <= key; i++) {
+        start = events[i];
+    }
+    free(events);
+    return start;
+}
+
+static void get_today(date_t *date) {
+    time_t time_now = time(NULL);
+    struct tm *now = gmtime(&time_now);
+
+    date->year = 1900 + now->tm_year;
+    date->month = 1 + now->tm_mon;
+    date->day = now->tm_mday;
+}
+
+#ifdef __linux__
+/* Wait until the watched data file was written or replaced. Other events
+ * in its directory are consumed and ignored.
+ */
+static bool data_file_changed(int inotify_fd, const char *name) {
+    char buffer[4096] __attribute__((aligned(__alignof__(struct inotify_event))));
+    const struct inotify_event *event;
+    bool changed = false;
+    ssize_t length;
+    char *position;
+
+    while((length = read(inotify_fd, buffer, sizeof(buffer))) > 0) {
+        for(position = buffer; position < buffer + length;
+            position += sizeof(struct inotify_event) + event->len) {
+            event = (const struct inotify_event *)position;
+            if(event->len > 0 && strcmp(event->name, name) == 0) {
+                changed = true;
+            }
+        }
+    }
+    return changed;
+}
+
+/* Report the series that changed with the reload of filename on stderr,
+ * like "Reloaded `FILE': added a, b; changed c; removed d.".
+ */
+static void report_reload(const char *filename, const reload_t *reload) {
+    static const char changes[] = "+=-";
+    static const char *const names[] = {"added", "changed", "removed"};
+    const char *separator = ":";
+    bool listed;
+    size_t kind;
+    size_t i;
+
+    if(reload->count == 0) {
+        return;
+    }
+    fprintf(stderr, NAME ": Reloaded `%s'", filename);
+    for(kind = 0; kind < strlen(changes); kind++) {
+        listed = false;
+        for(i = 0; i < reload->count; i++) {
+            if(reload->changes[i].change != changes[kind]) {
+                continue;
+            }
+            if(listed) {
+                fprintf(stderr, ", %s", reload->changes[i].series);
+            } else {
+                fprintf(stderr, "%s %s %s", separator, names[kind],
+                        reload->changes[i].series);
+                separator = ";";
+                listed = true;
+            }
+        }
+    }
+    fprintf(stderr, ".\n");
+}
+
+static void close_watch(const struct pollfd *fds) {
+    int i;
+
+    for(i = 0; i < 2; i++) {
+        if(fds[i].fd >= 0) {
+            close(fds[i].fd);
         }
-        distro_list = distro_list->next;
     }
+}
 
-    if(filtered_list == NULL) {
-        selected = NULL;
+/* Print the answer for today and then again whenever it changes, either
+ * because a milestone is reached (the timer is armed for midnight UTC of
+ * the next change) or because the data file was updated. Only returns on
+ * errors, or in test builds with -DWATCH_ANSWERS=N after N answers.
+ */
+maybe_unused static bool run_watch(const char *filename, snapshot_store_t *store,
+                                   const query_t *query) {
+#ifdef WATCH_ANSWERS
+    unsigned long answers_left = WATCH_ANSWERS;
+#endif
+    char *directory = strdup(filename);
+    const char *name;
+    char *previous = NULL;
+    char *answer;
+    snapshot_t *snapshot;
+    struct itimerspec timer;
+    struct pollfd fds[2];
+    date_t date;
+    date_t change;
+    bool first = true;
+    uint64_t expirations;
+    reload_t reload;
+
+    name = strrchr(filename, '/') ? strrchr(filename, '/') + 1 : filename;
+    if(name == filename) {
+        strcpy(directory, ".");
     } else {
-        selected = select_cb(filtered_list);
+        directory[name - filename - 1] = '\0';
     }
 
-    while(filtered_list != NULL) {
-        current = filtered_list->next;
-        free(filtered_list);
-        filtered_list = current;
+    fds[0].fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    fds[1].fd = timerfd_create(CLOCK_REALTIME, TFD_NONBLOCK | TFD_CLOEXEC);
+    if(unlikely(fds[0].fd < 0 || fds[1].fd < 0 ||
+                inotify_add_watch(fds[0].fd, directory, IN_CLOSE_WRITE |
+                                  IN_MOVED_TO | IN_CREATE) < 0)) {
+        fprintf(stderr, NAME ": Failed to watch %s: %s\n", directory,
+                strerror(errno));
+        close_watch(fds);
+        free(directory);
+        return false;
     }
+    fds[0].events = fds[1].events = POLLIN;
 
-    return selected;
+    for(;;) {
+        snapshot = snapshot_acquire(store);
+        get_today(&date);
+        answer = render_answer(snapshot->list, snapshot->table, query, &date);
+        if(first || !same_answer(answer, previous)) {
+            if(answer == NULL) {
+                report_no_answer(snapshot->table, query);
+            } else {
+                fputs(answer, stdout);
+                fflush(stdout);
+            }
+            first = false;
+#ifdef WATCH_ANSWERS
+            if(--answers_left == 0) {
+                snapshot_release(snapshot);
+                free(answer);
+                free(previous);
+                free(directory);
+                close_watch(fds);
+                return true;
+            }
+#endif
+        }
+        free(previous);
+        previous = answer;
+
+        memset(&timer, 0, sizeof(timer));
+        if(find_next_change(snapshot->list, snapshot->table, query, &date,
+                            &change)) {
+            struct tm tm = {0};
+
+            tm.tm_year = change.year - 1900;
+            tm.tm_mon = change.month - 1;
+            tm.tm_mday = change.day;
+            timer.it_value.tv_sec = timegm(&tm);
+        }
+        snapshot_release(snapshot);
+        // The clock being set cancels the timer, so that the date is rechecked.
+        timerfd_settime(fds[1].fd, TFD_TIMER_ABSTIME | TFD_TIMER_CANCEL_ON_SET,
+                        &timer, NULL);
+
+        while(poll(fds, 2, -1) < 0) {
+            if(errno != EINTR) {
+                fprintf(stderr, NAME ": poll failed: %s\n", strerror(errno));
+                close_watch(fds);
+                free(previous);
+                free(directory);
+                return false;
+            }
+        }
+        // Expired or canceled; both mean that the date is rechecked.
+        if((fds[1].revents & POLLIN) &&
+           read(fds[1].fd, &expirations, sizeof(expirations)) < 0 &&
+           errno != ECANCELED) {
+            fprintf(stderr, NAME ": Failed to read timer: %s\n", strerror(errno));
+            close_watch(fds);
+            free(previous);
+            free(directory);
+            return false;
+        }
+        if((fds[0].revents & POLLIN) && data_file_changed(fds[0].fd, name) &&
+           snapshot_reload(store, filename, &reload)) {
+            report_reload(filename, &reload);
+            free_reload(&reload);
+        }
+        // On failure the old data stays published and is used further.
+    }
 }
+#endif
 
-static void print_help(void) {
+maybe_unused static void print_help(void) {
     int i;
 
     printf("Usage: " NAME " [options]\n"
@@ -561,6 +5821,23 @@ static void print_help(void) {
            "Options:\n"
            "  -h  --help             show this help message and exit\n"
            "      --date=DATE        date for calculating the version (default: today)\n"
+           "      --dates-from=FILE  print the answer for every date listed in FILE\n"
+           "      --next-change      print the next date on which the answer changes\n"
+           "      --ttl              print the seconds until the answer changes\n"
+           "      --cache[=DIR]      cache the answer until it changes (default DIR:\n"
+           "                         $XDG_RUNTIME_DIR/distro-info)\n"
+           "      --watch            print the answer again whenever it changes\n"
+           "      --shared           share the parsed data with other processes\n"
+           "                         through shared memory\n"
+           "      --data-store=FILE  versioned data store (default:\n"
+           "                         " DATA_DIR "/" CSV_NAME ".store)\n"
+           "      --data-version=VERSION\n"
+           "                         use the data of VERSION from the data store\n"
+           "      --as-of-data=DATE  use the latest data from the data store that was\n"
+           "                         published by DATE\n"
+           "      --add-data-version=VERSION:DATE[:FILE]\n"
+           "                         add FILE (default: the current data) as VERSION\n"
+           "                         published on DATE to the data store\n"
            "      --series=SERIES    series to calculate the version for\n"
            "  -y[MILESTONE]          additionally, display days until milestone\n"
            "      --days=[MILESTONE] ("
@@ -596,6 +5873,32 @@ static void print_help(void) {
            "      --supported-esm    list of all Ubuntu Advantage supported stable versions\n"
 #endif
            "      --unsupported      list of all unsupported stable versions\n"
+           "      --query=EXPR       list of all versions matching the query expression\n"
+           "      --complete=PREFIX  list of all versions whose series, codename, or\n"
+           "                         version starts with PREFIX\n"
+           "      --stream           print the versions while reading the data (only\n"
+           "                         for options that list versions)\n"
+           "      --limit=N          print at most N versions\n"
+           "      --reverse          list the versions in reverse order\n"
+           "      --newest-first     list the newest versions first (by release date)\n"
+           "      --diff OLD NEW     changed milestones between the data files OLD and\n"
+           "                         NEW and the date ranges in which the answers of\n"
+           "                         the list and select options differ\n"
+           "      --status           table of the state, role, and days to every\n"
+           "                         milestone of all versions\n"
+           "      --metrics[=FILE]   write the --status data in the Prometheus text\n"
+           "                         format to FILE (default: standard output)\n"
+#ifdef DEBIAN
+           "      --join=MILESTONE:ROLE\n"
+           "                         for every version, the Ubuntu version that had\n"
+           "                         ROLE (devel, stable, lts) on its MILESTONE\n"
+#endif
+#ifdef UBUNTU
+           "      --join=MILESTONE:ROLE\n"
+           "                         for every version, the Debian version that had\n"
+           "                         ROLE (oldstable, stable, testing, unstable) on its\n"
+           "                         MILESTONE\n"
+#endif
            "  -c  --codename         print the codename (default)\n"
            "  -f  --fullname         print the full name\n"
            "  -r  --release          print the release version\n"
@@ -605,10 +5908,11 @@ static void print_help(void) {
 
 static inline int not_exactly_one(void) {
     fprintf(stderr, NAME ": You have to select exactly one of "
+            "--add-data-version, "
 #ifdef DEBIAN
             "--alias, "
 #endif
-            "--all, --devel, "
+            "--all, --complete, --devel, --diff, "
 #ifdef DEBIAN
             "--elts, "
 #endif
@@ -619,11 +5923,11 @@ static inline int not_exactly_one(void) {
 #ifdef DEBIAN
             "--oldstable, "
 #endif
-            "--stable, --supported, "
+            "--query, --stable, --supported, "
 #ifdef UBUNTU
             "--supported-esm, "
 #endif
-            "--series, "
+            "--join, --metrics, --series, --status, "
 #ifdef DEBIAN
             "--testing, "
 #endif
@@ -631,23 +5935,55 @@ static inline int not_exactly_one(void) {
     return EXIT_FAILURE;
 }
 
+#ifndef DISTRO_INFO_NO_MAIN
 int main(int argc, char *argv[]) {
     bool show_days = false;
     bool just_days = true;
-    char *content;
     date_t *date = NULL;
-    distro_elem_t *distro_list;
-    const distro_t *selected;
+    snapshot_t *snapshot;
+    const distro_elem_t *distro_list;
+    const distro_table_t *table;
+    query_t query;
+    char *dates_file = NULL;
+    enum NEXT_CHANGE next_change = NEXT_CHANGE_NONE;
+    bool date_given;
+    bool use_cache = false;
+    bool watch = false;
+    bool status = false;
+    bool metrics = false;
+    bool stream = false;
+    bool shared = false;
+    const char *store_file = DATA_DIR "/" CSV_NAME ".store";
+    char *data_version = NULL;
+    date_t *as_of = NULL;
+    date_t published = {0, 0, 0};
+    char *add_version = NULL;
+    date_t add_date;
+    char *add_file = NULL;
+    size_t limit = 0;
+    enum ORDER order = ORDER_FILE;
+    char *metrics_file = NULL;
+    char *complete_prefix = NULL;
+    char *diff_old = NULL;
+    char *diff_new = NULL;
+    int join_milestone = -1;
+    const join_role_t *join_role = NULL;
+    char *cache_dir = NULL;
+    char *key = NULL;
+    char *path = NULL;
+    char *filename;
+    char *merged;
     int i;
     int date_index = -1;
     char *series_name = NULL;
+    expr_t *expr = NULL;
     int option;
     int option_index;
     int return_value = EXIT_SUCCESS;
     int selected_filters = 0;
-    bool (*filter_cb)(const date_t*, const distro_t*) = NULL;
+    const filter_t *filter = NULL;
     const distro_t *(*select_cb)(const distro_elem_t*) = NULL;
-    bool (*print_cb)(const distro_t*, const date_t*, int, int) = print_codename;
+    bool (*print_cb)(FILE*, const distro_t*, const date_t*, int, int) = print_codename;
 #ifdef DEBIAN
     char *alias_codename = NULL;
 #endif
@@ -657,12 +5993,30 @@ int main(int argc, char *argv[]) {
 
     const struct option long_options[] = {
         {"help",          no_argument,       NULL, 'h' },
+        {"join",          required_argument, NULL, 'J' },
         {"date",          required_argument, NULL, 'D' },
+        {"dates-from",    required_argument, NULL, 'F' },
+        {"diff",          required_argument, NULL, 'Z' },
+        {"next-change",   no_argument,       NULL, 'N' },
+        {"ttl",           no_argument,       NULL, 'T' },
+        {"watch",         no_argument,       NULL, 'W' },
         {"series",        required_argument, NULL, 'R' },
+        {"shared",        no_argument,       NULL, 'H' },
+        {"data-store",    required_argument, NULL, 'G' },
+        {"data-version",  required_argument, NULL, 'E' },
+        {"as-of-data",    required_argument, NULL, 'X' },
+        {"add-data-version", required_argument, NULL, 'Y' },
         {"all",           no_argument,       NULL, 'a' },
+        {"cache",         optional_argument, NULL, 'C' },
+        {"complete",      required_argument, NULL, 'K' },
         {"days",          optional_argument, NULL, 'y' },
         {"devel",         no_argument,       NULL, 'd' },
         {"stable",        no_argument,       NULL, 's' },
+        {"status",        no_argument,       NULL, 'P' },
+        {"stream",        no_argument,       NULL, 'B' },
+        {"limit",         required_argument, NULL, 'I' },
+        {"reverse",       no_argument,       NULL, 'V' },
+        {"newest-first",  no_argument,       NULL, 'O' },
         {"supported",     no_argument,       NULL, 'S' },
 #ifdef UBUNTU
         {"supported-esm", no_argument,       NULL, 'e' },
@@ -671,6 +6025,8 @@ int main(int argc, char *argv[]) {
         {"codename",      no_argument,       NULL, 'c' },
         {"fullname",      no_argument,       NULL, 'f' },
         {"release",       no_argument,       NULL, 'r' },
+        {"query",         required_argument, NULL, 'Q' },
+        {"metrics",       optional_argument, NULL, 'M' },
 #ifdef DEBIAN
         {"alias",         required_argument, NULL, 'A' },
         {"elts",          no_argument,       NULL, 'e' },
@@ -719,10 +6075,119 @@ int main(int argc, char *argv[]) {
 
             case 'a':
                 selected_filters++;
-                filter_cb = filter_all;
+                filter = &filter_all;
                 select_cb = NULL;
                 break;
 
+            case 'C':
+                // Only long option --cache is used
+                use_cache = true;
+                cache_dir = optarg;
+                break;
+
+            case 'B':
+                // Only long option --stream is used
+                stream = true;
+                break;
+
+            case 'H':
+                // Only long option --shared is used
+                shared = true;
+                break;
+
+            case 'G':
+                // Only long option --data-store is used
+                store_file = optarg;
+                break;
+
+            case 'E':
+                // Only long option --data-version is used
+                data_version = optarg;
+                break;
+
+            case 'X':
+                // Only long option --as-of-data is used
+                if(unlikely(as_of != NULL)) {
+                    fprintf(stderr, NAME ": --as-of-data specified multiple times.\n");
+                    free(as_of);
+                    free(date);
+                    return EXIT_FAILURE;
+                }
+                as_of = malloc(sizeof(date_t));
+                if(!parse_date(optarg, as_of)) {
+                    fprintf(stderr, NAME ": invalid date `%s'\n", optarg);
+                    free(as_of);
+                    free(date);
+                    return EXIT_FAILURE;
+                }
+                break;
+
+            case 'Y':
+                // Only long option --add-data-version is used
+                {
+                    char *date_string = strchr(optarg, ':');
+                    char *file = date_string ? strchr(date_string + 1, ':') : NULL;
+
+                    if(file != NULL) {
+                        *file++ = '\0';
+                    }
+                    if(date_string != NULL) {
+                        *date_string++ = '\0';
+                    }
+                    if(date_string == NULL || *optarg == '\0' ||
+                       strpbrk(optarg, " \t\n") != NULL ||
+                       !parse_date(date_string, &add_date)) {
+                        fprintf(stderr, NAME ": invalid data version `%s' "
+                                "(expected VERSION:DATE[:FILE])\n", optarg);
+                        free(as_of);
+                        free(date);
+                        return EXIT_FAILURE;
+                    }
+                    selected_filters++;
+                    add_version = optarg;
+                    add_file = file;
+                }
+                break;
+
+            case 'I':
+                // Only long option --limit is used
+                {
+                    char *end;
+
+                    errno = 0;
+                    limit = strtoul(optarg, &end, 10);
+                    if(*optarg < '0' || *optarg > '9' || *end != '\0' ||
+                       errno != 0 || limit == 0) {
+                        fprintf(stderr, NAME ": invalid limit `%s' (expected a "
+                                "positive number)\n", optarg);
+                        free(date);
+                        return EXIT_FAILURE;
+                    }
+                }
+                break;
+
+            case 'V':
+                // Only long option --reverse is used
+                if(unlikely(order == ORDER_NEWEST)) {
+                    fprintf(stderr, NAME ": --reverse and --newest-first are "
+                            "mutually exclusive.\n");
+                    free(date);
+                    return EXIT_FAILURE;
+                }
+                order = ORDER_REVERSE;
+                break;
+
+            case 'O':
+                // Only long option --newest-first is used
+                if(unlikely(order == ORDER_REVERSE)) {
+                    fprintf(stderr, NAME ": --reverse and --newest-first are "
+                            "mutually exclusive.\n");
+                    free(date);
+                    return EXIT_FAILURE;
+                }
+                order = ORDER_NEWEST;
+                break;
+
             case 'c':
                 just_days = false;
                 print_cb = print_codename;
@@ -730,7 +6195,7 @@ int main(int argc, char *argv[]) {
 
             case 'd':
                 selected_filters++;
-                filter_cb = filter_devel;
+                filter = &filter_devel;
 #ifdef UBUNTU
                 select_cb = select_latest_created;
 #endif
@@ -747,15 +6212,71 @@ int main(int argc, char *argv[]) {
                     return EXIT_FAILURE;
                 }
                 date = malloc(sizeof(date_t));
-                i = sscanf(optarg, "%u-%u-%u", &date->year, &date->month,
-                           &date->day);
-                if(i != 3 || !is_valid_date(date)) {
+                if(!parse_date(optarg, date)) {
                     fprintf(stderr, NAME ": invalid date `%s'\n", optarg);
                     free(date);
                     return EXIT_FAILURE;
                 }
                 break;
 
+            case 'N':
+                // Only long option --next-change is used
+                if(unlikely(next_change == NEXT_CHANGE_TTL)) {
+                    fprintf(stderr, NAME ": --next-change and --ttl are "
+                            "mutually exclusive.\n");
+                    free(date);
+                    return EXIT_FAILURE;
+                }
+                next_change = NEXT_CHANGE_DATE;
+                break;
+
+            case 'T':
+                // Only long option --ttl is used
+                if(unlikely(next_change == NEXT_CHANGE_DATE)) {
+                    fprintf(stderr, NAME ": --next-change and --ttl are "
+                            "mutually exclusive.\n");
+                    free(date);
+                    return EXIT_FAILURE;
+                }
+                next_change = NEXT_CHANGE_TTL;
+                break;
+
+            case 'W':
+                // Only long option --watch is used
+#ifndef __linux__
+                fprintf(stderr, NAME ": --watch is only supported on Linux.\n");
+                free(date);
+                return EXIT_FAILURE;
+#endif
+                watch = true;
+                break;
+
+            case 'Q':
+                // Only long option --query is used
+                if(unlikely(expr != NULL)) {
+                    fprintf(stderr, NAME ": --query requested multiple times.\n");
+                    free_expr(expr);
+                    free(date);
+                    return EXIT_FAILURE;
+                }
+                expr = compile_expr(optarg);
+                if(expr == NULL) {
+                    free(date);
+                    return EXIT_FAILURE;
+                }
+                selected_filters++;
+                break;
+
+            case 'F':
+                // Only long option --dates-from is used
+                if(unlikely(dates_file != NULL)) {
+                    fprintf(stderr, NAME ": --dates-from requested multiple times.\n");
+                    free(date);
+                    return EXIT_FAILURE;
+                }
+                dates_file = optarg;
+                break;
+
             case 'R':
                 // Only long option --series is used
                 if(unlikely(series_name != NULL)) {
@@ -786,14 +6307,14 @@ int main(int argc, char *argv[]) {
             case 'l':
                 selected_filters++;
                 filter_latest = true;
-                filter_cb = filter_devel;
+                filter = &filter_devel;
                 select_cb = select_latest_created;
                 break;
 
             case 'L':
                 // Only long option --lts is used
                 selected_filters++;
-                filter_cb = filter_lts;
+                filter = &filter_lts;
                 select_cb = select_latest_release;
                 break;
 #endif
@@ -801,19 +6322,19 @@ int main(int argc, char *argv[]) {
 #ifdef DEBIAN
             case 'e':
                 selected_filters++;
-                filter_cb = filter_elts_supported;
+                filter = &filter_elts_supported;
                 select_cb = NULL;
                 break;
 
             case 'l':
                 selected_filters++;
-                filter_cb = filter_lts_supported;
+                filter = &filter_lts_supported;
                 select_cb = NULL;
                 break;
 
             case 'o':
                 selected_filters++;
-                filter_cb = filter_oldstable;
+                filter = &filter_oldstable;
                 select_cb = select_oldstable;
                 break;
 #endif
@@ -825,14 +6346,48 @@ int main(int argc, char *argv[]) {
 
             case 's':
                 selected_filters++;
-                filter_cb = filter_stable;
+                filter = &filter_stable;
                 select_cb = select_latest_release;
                 break;
 
+            case 'K':
+                // Only long option --complete is used
+                selected_filters++;
+                complete_prefix = optarg;
+                break;
+
+            case 'Z':
+                // Only long option --diff is used
+                selected_filters++;
+                diff_old = optarg;
+                break;
+
+            case 'J':
+                // Only long option --join is used
+                selected_filters++;
+                if(!parse_join(optarg, &join_milestone, &join_role)) {
+                    free(date);
+                    return EXIT_FAILURE;
+                }
+                break;
+
+            case 'M':
+                // Only long option --metrics is used
+                selected_filters++;
+                metrics = true;
+                metrics_file = optarg;
+                break;
+
+            case 'P':
+                // Only long option --status is used
+                selected_filters++;
+                status = true;
+                break;
+
             case 'S':
                 // Only long option --supported is used
                 selected_filters++;
-                filter_cb = filter_supported;
+                filter = &filter_supported;
                 select_cb = NULL;
                 break;
 
@@ -840,7 +6395,7 @@ int main(int argc, char *argv[]) {
             case 'e':
                 // Only long option --supported-esm is used
                 selected_filters++;
-                filter_cb = filter_esm_supported;
+                filter = &filter_esm_supported;
                 select_cb = NULL;
                 break;
 
@@ -848,7 +6403,7 @@ int main(int argc, char *argv[]) {
 #ifdef DEBIAN
             case 't':
                 selected_filters++;
-                filter_cb = filter_testing;
+                filter = &filter_testing;
                 select_cb = select_latest_created;
                 break;
 #endif
@@ -856,7 +6411,7 @@ int main(int argc, char *argv[]) {
             case 'U':
                 // Only long option --unsupported is used
                 selected_filters++;
-                filter_cb = filter_unsupported;
+                filter = &filter_unsupported;
                 select_cb = NULL;
                 break;
 
@@ -885,6 +6440,36 @@ int main(int argc, char *argv[]) {
                 } else if(optopt == 'D') {
                     fprintf(stderr, NAME ": option `--date' requires "
                             "an argument DATE\n");
+                } else if(optopt == 'F') {
+                    fprintf(stderr, NAME ": option `--dates-from' requires "
+                            "an argument FILE\n");
+                } else if(optopt == 'Z') {
+                    fprintf(stderr, NAME ": option `--diff' requires "
+                            "an argument OLD\n");
+                } else if(optopt == 'G') {
+                    fprintf(stderr, NAME ": option `--data-store' requires "
+                            "an argument FILE\n");
+                } else if(optopt == 'E') {
+                    fprintf(stderr, NAME ": option `--data-version' requires "
+                            "an argument VERSION\n");
+                } else if(optopt == 'X') {
+                    fprintf(stderr, NAME ": option `--as-of-data' requires "
+                            "an argument DATE\n");
+                } else if(optopt == 'Y') {
+                    fprintf(stderr, NAME ": option `--add-data-version' requires "
+                            "an argument VERSION:DATE[:FILE]\n");
+                } else if(optopt == 'I') {
+                    fprintf(stderr, NAME ": option `--limit' requires "
+                            "an argument N\n");
+                } else if(optopt == 'K') {
+                    fprintf(stderr, NAME ": option `--complete' requires "
+                            "an argument PREFIX\n");
+                } else if(optopt == 'J') {
+                    fprintf(stderr, NAME ": option `--join' requires "
+                            "an argument MILESTONE:ROLE\n");
+                } else if(optopt == 'Q') {
+                    fprintf(stderr, NAME ": option `--query' requires "
+                            "an argument EXPR\n");
                 } else if(optopt == 'R') {
                     fprintf(stderr, NAME ": option `--series' requires "
                             "an argument SERIES\n");
@@ -908,6 +6493,19 @@ int main(int argc, char *argv[]) {
         date_index = MILESTONE_RELEASE;
     }
 
+    if(diff_old != NULL) {
+        // --diff OLD NEW takes the data file NEW as the first operand
+        if(unlikely(optind == argc)) {
+            fprintf(stderr, NAME ": option `--diff' requires a second "
+                    "argument NEW\n");
+            free_expr(expr);
+            free(as_of);
+            free(date);
+            return EXIT_FAILURE;
+        }
+        diff_new = argv[optind++];
+    }
+
     if(unlikely(optind < argc)) {
         fprintf(stderr, NAME ": unrecognized arguments: %s", argv[optind]);
         for(i = optind + 1; i < argc; i++) {
@@ -919,83 +6517,376 @@ int main(int argc, char *argv[]) {
     }
 
     if(unlikely(selected_filters != 1)) {
+        free_expr(expr);
         free(date);
         return not_exactly_one();
     }
 
-    if(unlikely(date == NULL)) {
-        time_t time_now = time(NULL);
-        struct tm *now = gmtime(&time_now);
-        date = malloc(sizeof(date_t));
-        date->year = 1900 + now->tm_year;
-        date->month = 1 + now->tm_mon;
-        date->day = now->tm_mday;
+    if(unlikely(date != NULL && dates_file != NULL)) {
+        fprintf(stderr, NAME ": --date and --dates-from are mutually exclusive.\n");
+        free_expr(expr);
+        free(date);
+        return EXIT_FAILURE;
     }
 
-    distro_list = read_data(DATA_DIR "/" CSV_NAME ".csv", &content);
-    if(unlikely(distro_list == NULL)) {
+    if(unlikely(next_change != NEXT_CHANGE_NONE && dates_file != NULL)) {
+        fprintf(stderr, NAME ": --%s and --dates-from are mutually exclusive.\n",
+                next_change == NEXT_CHANGE_DATE ? "next-change" : "ttl");
+        free_expr(expr);
+        return EXIT_FAILURE;
+    }
+
+    if(unlikely(watch && (date != NULL || dates_file != NULL || use_cache ||
+                          next_change != NEXT_CHANGE_NONE))) {
+        fprintf(stderr, NAME ": --watch cannot be combined with --date, "
+                "--dates-from, --next-change, --ttl, or --cache.\n");
+        free_expr(expr);
+        free(date);
+        return EXIT_FAILURE;
+    }
+
+    if(unlikely((status || metrics || join_role || complete_prefix) &&
+                (dates_file != NULL || watch || next_change != NEXT_CHANGE_NONE))) {
+        fprintf(stderr, NAME ": --%s cannot be combined with --dates-from, "
+                "--next-change, --ttl, or --watch.\n",
+                status ? "status" : metrics ? "metrics" : join_role ? "join"
+                : "complete");
+        free_expr(expr);
+        free(date);
+        return EXIT_FAILURE;
+    }
+
+    if(unlikely((status || metrics || join_role || complete_prefix) &&
+                (show_days || !just_days))) {
+        fprintf(stderr, NAME ": --%s cannot be combined with --codename, "
+                "--days, --fullname, or --release.\n",
+                status ? "status" : metrics ? "metrics" : join_role ? "join"
+                : "complete");
+        free_expr(expr);
         free(date);
         return EXIT_FAILURE;
     }
 
+    if(unlikely(stream && (filter == NULL || select_cb != NULL || use_cache ||
+                           dates_file != NULL || watch ||
+                           next_change != NEXT_CHANGE_NONE))) {
+        fprintf(stderr, NAME ": --stream only works with --all, "
 #ifdef DEBIAN
-    if(alias_codename) {
-        const distro_t *oldstable = get_distro(distro_list, date, filter_oldstable,
-                                               select_oldstable);
-        const distro_t *stable = get_distro(distro_list, date, filter_stable,
-                                            select_latest_release);
-        const distro_t *testing = get_distro(distro_list, date, filter_testing,
-                                             select_latest_created);
-        const distro_t *unstable = get_distro(distro_list, date, filter_devel,
-                                              select_first);
-        if(unlikely(oldstable == NULL || stable == NULL || testing == NULL ||
-                    unstable == NULL)) {
-            fprintf(stderr, NAME ": " OUTDATED_ERROR "\n");
+                "--elts, --lts, "
+#endif
+                "--supported, "
+#ifdef UBUNTU
+                "--supported-esm, "
+#endif
+                "or --unsupported and without --cache, --dates-from, "
+                "--next-change, --ttl, or --watch.\n");
+        free_expr(expr);
+        free(date);
+        return EXIT_FAILURE;
+    }
+
+    if(unlikely((limit > 0 || order != ORDER_FILE) &&
+                (filter == NULL || select_cb != NULL))) {
+        fprintf(stderr, NAME ": --limit, --reverse, and --newest-first only work "
+                "with --all, "
+#ifdef DEBIAN
+                "--elts, --lts, "
+#endif
+                "--supported, "
+#ifdef UBUNTU
+                "--supported-esm, "
+#endif
+                "or --unsupported.\n");
+        free_expr(expr);
+        free(date);
+        return EXIT_FAILURE;
+    }
+
+    if(unlikely(stream && order != ORDER_FILE)) {
+        fprintf(stderr, NAME ": --stream cannot be combined with --reverse or "
+                "--newest-first.\n");
+        free_expr(expr);
+        free(date);
+        return EXIT_FAILURE;
+    }
+
+    if(unlikely(data_version != NULL && as_of != NULL)) {
+        fprintf(stderr, NAME ": --data-version and --as-of-data are mutually "
+                "exclusive.\n");
+        free_expr(expr);
+        free(as_of);
+        free(date);
+        return EXIT_FAILURE;
+    }
+
+    if(unlikely((data_version != NULL || as_of != NULL) &&
+                (stream || shared || use_cache || watch))) {
+        fprintf(stderr, NAME ": --%s cannot be combined with --cache, --shared, "
+                "--stream, or --watch.\n",
+                data_version != NULL ? "data-version" : "as-of-data");
+        free_expr(expr);
+        free(as_of);
+        free(date);
+        return EXIT_FAILURE;
+    }
+
+    if(diff_old != NULL) {
+        if(unlikely(date != NULL || dates_file != NULL || show_days || use_cache ||
+                    shared || watch || stream || data_version != NULL ||
+                    as_of != NULL || next_change != NEXT_CHANGE_NONE)) {
+            fprintf(stderr, NAME ": --diff cannot be combined with --as-of-data, "
+                    "--cache, --data-version, --date, --dates-from, --days, "
+                    "--next-change, --shared, --stream, --ttl, or --watch.\n");
+            return_value = EXIT_FAILURE;
+        } else if(!print_diff(stdout, diff_old, diff_new)) {
             return_value = EXIT_FAILURE;
-        } else if(strcmp(oldstable->series, alias_codename) == 0) {
-            printf("oldstable\n");
-        } else if(strcmp(stable->series, alias_codename) == 0) {
-            printf("stable\n");
-        } else if(strcmp(testing->series, alias_codename) == 0) {
-            printf("testing\n");
-        } else if(strcmp(unstable->series, alias_codename) == 0) {
-            printf("unstable\n");
-        } else {
-            printf("%s\n", alias_codename);
         }
+        free(as_of);
         free(date);
-        free_data(distro_list, &content);
         return return_value;
     }
-#endif
 
-    if(select_cb == NULL && !series_name) {
-        filter_data(distro_list, date, date_index, just_days, filter_cb, print_cb);
-    } else {
-        if(series_name) {
-            selected = select_series(distro_list, series_name);
+    filename = overlay_data_file(CSV_NAME, CSV_HEADER, milestones, &merged);
+    if(unlikely(filename == NULL)) {
+        free_expr(expr);
+        free(as_of);
+        free(date);
+        return EXIT_FAILURE;
+    }
+    if(unlikely(watch && strcmp(filename, DATA_DIR "/" CSV_NAME ".csv") != 0)) {
+        fprintf(stderr, NAME ": --watch cannot be used with DISTRO_INFO_OVERLAYS.\n");
+        free(merged);
+        free(filename);
+        free_expr(expr);
+        free(as_of);
+        free(date);
+        return EXIT_FAILURE;
+    }
+
+    if(add_version != NULL) {
+        if(unlikely(add_file == NULL && merged != NULL)) {
+            fprintf(stderr, NAME ": --add-data-version needs a FILE if the merged "
+                    "data of DISTRO_INFO_OVERLAYS cannot be cached.\n");
+            return_value = EXIT_FAILURE;
         } else {
-            selected = get_distro(distro_list, date, filter_cb, select_cb);
+            return_value = store_add_version(store_file, add_version, &add_date,
+                                             add_file ? add_file : filename)
+                           ? EXIT_SUCCESS : EXIT_FAILURE;
+        }
+        free(merged);
+        free(filename);
+        free(as_of);
+        free(date);
+        return return_value;
+    }
+
+    date_given = date != NULL;
+
+    if(unlikely(date == NULL)) {
+        date = malloc(sizeof(date_t));
+        get_today(date);
+    }
+
+    query.filter = filter;
+    query.expr = expr;
+    query.select_cb = select_cb;
+    query.series = series_name;
+#ifdef DEBIAN
+    query.alias = alias_codename;
+#endif
 #ifdef UBUNTU
-            if(selected == NULL && filter_latest) {
-                selected = get_distro(distro_list, date, filter_stable, select_latest_release);
+    query.latest = filter_latest;
+#endif
+    query.date_index = date_index;
+    query.just_days = just_days;
+    query.print_cb = print_cb;
+    query.limit = limit;
+    query.order = order;
+
+    // The merged data in memory is answered like a loaded data file.
+    if(stream && merged == NULL) {
+        return_value = stream_data(filename, &query, date) ? EXIT_SUCCESS
+                                                           : EXIT_FAILURE;
+        free(filename);
+        free(date);
+        return return_value;
+    }
+
+    if(filter != NULL && select_cb == NULL && limit == 0 && order == ORDER_FILE &&
+       !shared && data_version == NULL && as_of == NULL && !use_cache &&
+       merged == NULL && !dates_file && !watch && next_change == NEXT_CHANGE_NONE) {
+        enum PARALLEL parallel = parallel_data(filename, &query, date);
+
+        if(parallel != PARALLEL_SERIAL) {
+            free(filename);
+            free(date);
+            return parallel == PARALLEL_SUCCESS ? EXIT_SUCCESS : EXIT_FAILURE;
+        }
+    }
+
+    if(use_cache && cache_dir == NULL && getenv("XDG_RUNTIME_DIR")) {
+        cache_dir = malloc(strlen(getenv("XDG_RUNTIME_DIR")) + 13);
+        sprintf(cache_dir, "%s/distro-info", getenv("XDG_RUNTIME_DIR"));
+    } else if(cache_dir) {
+        cache_dir = strdup(cache_dir);
+    }
+    if(cache_dir && merged == NULL && !dates_file && !status && !metrics &&
+       !join_role && !complete_prefix && next_change == NEXT_CHANGE_NONE) {
+        key = cache_key(filename, &query);
+        if(key) {
+            path = cache_path(cache_dir, key);
+            if(cache_lookup(path, key, date)) {
+                free(filename);
+                free(path);
+                free(key);
+                free(cache_dir);
+                free_expr(expr);
+                free(date);
+                return EXIT_SUCCESS;
             }
+        }
+    }
+
+    if(data_version != NULL || as_of != NULL) {
+        snapshot = snapshot_load_version(store_file, data_version, as_of,
+                                         &published);
+        free(as_of);
+        free(merged);
+    } else if(merged != NULL) {
+        distro_elem_t *merged_list = parse_csv(filename, CSV_HEADER, milestones,
+                                               &merged);
+
+        snapshot = merged_list ? snapshot_new(merged_list, merged) : NULL;
+    } else if(shared) {
+        snapshot = snapshot_open_shared(filename);
+    } else if(watch) {
+        snapshot = snapshot_read(filename);
+    } else {
+        snapshot = snapshot_load(filename);
+    }
+    if(unlikely(snapshot == NULL)) {
+        free(filename);
+        free(path);
+        free(key);
+        free(cache_dir);
+        free_expr(expr);
+        free(date);
+        return EXIT_FAILURE;
+    }
+
+    distro_list = snapshot->list;
+    table = snapshot->table;
+#ifdef __linux__
+    if(watch) {
+        snapshot_store_t store = {snapshot, 0, {0, 0}, false};
+
+        return_value = run_watch(filename, &store, &query) ? EXIT_SUCCESS : EXIT_FAILURE;
+        // The store owns the reference now; it may hold a reloaded snapshot.
+        snapshot_publish(&store, NULL);
+        free(filename);
+        free_expr(expr);
+        free(date);
+        return return_value;
+    }
 #endif
+    if(complete_prefix) {
+        print_completions(stdout, table, complete_prefix);
+    } else if(status) {
+        if(!print_status(stdout, distro_list, date)) {
+            return_value = EXIT_FAILURE;
         }
-        if(selected == NULL) {
-            if(series_name) {
-                fprintf(stderr, NAME ": unknown distribution series `%s'\n", series_name);
-            } else {
-                fprintf(stderr, NAME ": " OUTDATED_ERROR "\n");
+    } else if(metrics) {
+        char *buffer;
+        size_t size;
+        FILE *stream;
+
+        stream = open_memstream(&buffer, &size);
+        print_metrics(stream, distro_list, date,
+                      published.year != 0 ? date_to_secs(&published)
+                                          : overlay_mtime(CSV_NAME));
+        fclose(stream);
+        if(metrics_file == NULL) {
+            if(fwrite(buffer, 1, size, stdout) != size) {
+                return_value = EXIT_FAILURE;
             }
+        } else if(!write_atomically(metrics_file, buffer, size, true)) {
+            return_value = EXIT_FAILURE;
+        }
+        free(buffer);
+    } else if(join_role) {
+        static char *join_milestones[] = {JOIN_MILESTONES(MILESTONE_NAME)};
+        char *join_content;
+        char *join_filename = overlay_data_file(JOIN_CSV_NAME, JOIN_CSV_HEADER,
+                                                join_milestones, &join_content);
+        distro_elem_t *join_list = NULL;
+
+        if(join_content != NULL) {
+            join_list = parse_csv(join_filename, JOIN_CSV_HEADER, join_milestones,
+                                  &join_content);
+        } else if(join_filename != NULL) {
+            join_list = read_csv(join_filename, JOIN_CSV_HEADER, join_milestones,
+                                 &join_content);
+        }
+        if(join_list == NULL) {
             return_value = EXIT_FAILURE;
         } else {
-            if(!print_cb(selected, date, date_index, just_days)) {
-                return_value = EXIT_FAILURE;
+            print_join(stdout, distro_list, join_list, join_milestone, join_role);
+            free_data(join_list, &join_content);
+        }
+        free(join_filename);
+    } else if(dates_file) {
+        if(!run_dates(dates_file, distro_list, table, &query)) {
+            return_value = EXIT_FAILURE;
+        }
+    } else if(next_change != NEXT_CHANGE_NONE) {
+        date_t change;
+
+        if(!find_next_change(distro_list, table, &query, date, &change)) {
+            fprintf(stderr, NAME ": No known milestone changes the answer.\n");
+            return_value = EXIT_FAILURE;
+        } else if(next_change == NEXT_CHANGE_DATE) {
+            printf("%04u-%02u-%02u\n", change.year, change.month, change.day);
+        } else {
+            /* Seconds until midnight (UTC) of the change day, counted from
+             * now or from the start of the given --date.
+             */
+            long long ttl = (long long)date_diff(&change, date) * 60 * 60 * 24;
+            if(!date_given) {
+                ttl -= time(NULL) % (60 * 60 * 24);
             }
+            printf("%lld\n", ttl);
+        }
+    } else if(path) {
+        char *answer = render_answer(distro_list, table, &query, date);
+        date_t change;
+
+        if(answer == NULL) {
+            report_no_answer(table, &query);
+            return_value = EXIT_FAILURE;
+        } else {
+            fputs(answer, stdout);
+            cache_store(cache_dir, path, key,
+                        query.date_index >= 0 ? date_to_key(date)
+                                              : interval_start(table, date),
+                        find_next_change(distro_list, table, &query, date, &change)
+                            ? date_to_key(&change) : DATEKEY_ABSENT,
+                        answer);
+            free(answer);
         }
+    } else if(!run_query(stdout, distro_list, table, &query, date)) {
+        // Nothing to report if the output is gone (like EPIPE).
+        if(!ferror(stdout)) {
+            report_no_answer(table, &query);
+        }
+        return_value = EXIT_FAILURE;
     }
+    free(filename);
+    free(path);
+    free(key);
+    free(cache_dir);
+    free_expr(expr);
     free(date);
-    free_data(distro_list, &content);
+    snapshot_release(snapshot);
     return return_value;
 }
+#endif
@@ -19,40 +19,241 @@
 
 // C standard libraries
 #include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
 
 #ifdef __GNUC__
 #define likely(x)   __builtin_expect((x),1)
 #define unlikely(x) __builtin_expect((x),0)
 #define unused(x) x __attribute ((unused))
+#define maybe_unused __attribute ((unused))
+#define always_inline inline __attribute ((always_inline))
 #else
 #define likely(x)   (x)
 #define unlikely(x) (x)
 #define unused(x) x
+#define maybe_unused
+#define always_inline inline
 #endif
 
-/* NOTE: Must be kept in sync with milestones array. */
-enum MILESTONE {MILESTONE_CREATED
-               ,MILESTONE_RELEASE
-               ,MILESTONE_EOL
+/* Column kernels are compiled for AVX2 and a baseline version. The dynamic
+ * loader picks the one that matches the running CPU.
+ */
+#if defined(__GNUC__) && !defined(__clang__) && defined(__x86_64__) && \
+    defined(__GLIBC__) && !defined(__SANITIZE_THREAD__)
+#define vectorized __attribute__((target_clones("avx2", "default")))
+#else
+#define vectorized
+#endif
+
+/* The vendor definitions below exist for both vendors. A binary uses the
+ * ones of its vendor and --join the ones of the other vendor.
+ *
+ * Milestones of the data files as X(ID, name). Both vendors have the same
+ * number of them and start with created, release, and eol.
+ */
+#define DEBIAN_MILESTONES(X) X(CREATED, "created") X(RELEASE, "release") \
+                             X(EOL, "eol") X(EOL_LTS, "eol-lts") X(EOL_ELTS, "eol-elts")
+#define UBUNTU_MILESTONES(X) X(CREATED, "created") X(RELEASE, "release") \
+                             X(EOL, "eol") X(EOL_SERVER, "eol-server") \
+                             X(EOL_ESM, "eol-esm")
+
+/* Row predicates that all filters are built from, as X(ID, name). The
+ * names are used in --query expressions.
+ */
+#define DEBIAN_PREDICATES(X) X(CREATED, "created") X(RELEASED, "released") \
+                             X(EOL, "eol") X(EOL_LTS, "eol_lts") \
+                             X(EOL_ELTS, "eol_elts") X(VERSIONED, "versioned")
+#define UBUNTU_PREDICATES(X) X(CREATED, "created") X(RELEASED, "released") \
+                             X(EOL, "eol") X(EOL_ESM, "eol_esm") X(LTS, "lts") \
+                             X(VERSIONED, "versioned")
+
+/* How the predicates of a row follow from its milestones, as X(ID,
+ * condition). REACHED(M) holds if milestone M is known and reached,
+ * PASSED(M) if it is reached or unknown, IS_VERSIONED if the row has a
+ * version, and IS_LTS if it is a long term support version.
+ */
+#define DEBIAN_RULES(X, REACHED, PASSED, IS_VERSIONED, IS_LTS) \
+    X(CREATED, REACHED(CREATED)) \
+    X(RELEASED, IS_VERSIONED && REACHED(RELEASE)) \
+    X(EOL, REACHED(EOL)) \
+    X(EOL_LTS, PASSED(EOL_LTS)) \
+    X(EOL_ELTS, PASSED(EOL_ELTS)) \
+    X(VERSIONED, IS_VERSIONED)
+#define UBUNTU_RULES(X, REACHED, PASSED, IS_VERSIONED, IS_LTS) \
+    X(CREATED, REACHED(CREATED)) \
+    X(RELEASED, IS_VERSIONED && REACHED(RELEASE)) \
+    X(EOL, REACHED(EOL) && PASSED(EOL_SERVER)) \
+    X(EOL_ESM, REACHED(EOL) && PASSED(EOL_ESM)) \
+    X(LTS, IS_LTS) \
+    X(VERSIONED, IS_VERSIONED)
+
+/* Roles as X(filter, role, require, exclude, select): select_<select>()
+ * picks one of the versions whose predicates (given to P) include require
+ * and none of exclude. A binary defines filter_<filter> for the options of
+ * its vendor; --join looks up the roles of the other vendor by name.
+ */
+#define DEBIAN_ROLES(X, P) \
+    X(oldstable, oldstable, P(CREATED) | P(RELEASED), 0, oldstable) \
+    X(stable, stable, P(RELEASED), P(EOL), latest_release) \
+    X(testing, testing, P(CREATED), P(RELEASED), latest_created) \
+    X(devel, unstable, P(CREATED), P(VERSIONED), first)
+#define UBUNTU_ROLES(X, P) \
+    X(devel, devel, P(CREATED), P(RELEASED), latest_created) \
+    X(stable, stable, P(RELEASED), P(EOL), latest_release) \
+    X(lts, lts, P(LTS) | P(RELEASED), P(EOL), latest_release)
+
 #ifdef DEBIAN
-               ,MILESTONE_EOL_LTS
-               ,MILESTONE_EOL_ELTS
+#define VENDOR_MILESTONES DEBIAN_MILESTONES
+#define VENDOR_PREDICATES DEBIAN_PREDICATES
+#define VENDOR_RULES DEBIAN_RULES
+#define VENDOR_ROLES DEBIAN_ROLES
+#define JOIN_MILESTONES UBUNTU_MILESTONES
+#define JOIN_PREDICATES UBUNTU_PREDICATES
+#define JOIN_RULES UBUNTU_RULES
+#define JOIN_ROLES UBUNTU_ROLES
 #endif
 #ifdef UBUNTU
-               ,MILESTONE_EOL_SERVER
-               ,MILESTONE_EOL_ESM
+#define VENDOR_MILESTONES UBUNTU_MILESTONES
+#define VENDOR_PREDICATES UBUNTU_PREDICATES
+#define VENDOR_RULES UBUNTU_RULES
+#define VENDOR_ROLES UBUNTU_ROLES
+#define JOIN_MILESTONES DEBIAN_MILESTONES
+#define JOIN_PREDICATES DEBIAN_PREDICATES
+#define JOIN_RULES DEBIAN_RULES
+#define JOIN_ROLES DEBIAN_ROLES
 #endif
-               ,MILESTONE_COUNT
+
+#define MILESTONE_ENUM(id, name) MILESTONE_##id,
+#define JOIN_MILESTONE_ENUM(id, name) JOIN_MILESTONE_##id,
+#define PREDICATE_ENUM(id, name) PREDICATE_##id,
+#define JOIN_PREDICATE_ENUM(id, name) JOIN_PREDICATE_##id,
+
+enum MILESTONE {VENDOR_MILESTONES(MILESTONE_ENUM) MILESTONE_COUNT};
+enum JOIN_MILESTONE {JOIN_MILESTONES(JOIN_MILESTONE_ENUM) JOIN_MILESTONE_COUNT};
+enum PREDICATE {VENDOR_PREDICATES(PREDICATE_ENUM) PREDICATE_COUNT};
+enum JOIN_PREDICATE {JOIN_PREDICATES(JOIN_PREDICATE_ENUM) JOIN_PREDICATE_COUNT};
+
+#define PREDICATE(p) (1U << PREDICATE_##p)
+#define JOIN_PREDICATE(p) (1U << JOIN_PREDICATE_##p)
+
+enum NEXT_CHANGE {NEXT_CHANGE_NONE
+                 ,NEXT_CHANGE_DATE
+                 ,NEXT_CHANGE_TTL
+};
+
+/* Output formats and days modes that the list kernels are specialized for
+ * (see KERNEL_FILTERS in distro-info-util.c).
+ */
+enum KERNEL_PRINT {KERNEL_CODENAME
+                   ,KERNEL_FULLNAME
+                   ,KERNEL_RELEASE
+};
+
+enum KERNEL_DAYS {KERNEL_PLAIN
+                  ,KERNEL_DAYS
+                  ,KERNEL_JUST_DAYS
+                  ,KERNEL_DAYS_COUNT
+};
+
+/* Selectors that the select kernels are specialized for. */
+enum KERNEL_SELECT {KERNEL_FIRST
+                    ,KERNEL_LATEST_CREATED
+                    ,KERNEL_LATEST_RELEASE
+                    ,KERNEL_OLDSTABLE
+};
+
+/* Order in which a query lists the versions. */
+enum ORDER {ORDER_FILE
+            ,ORDER_REVERSE
+            ,ORDER_NEWEST
+};
+
+/* Result of looking for a shared snapshot (see snapshot_attach()). */
+enum SHARED {SHARED_ATTACHED
+             ,SHARED_MISSING
+             ,SHARED_STALE
+             ,SHARED_BUSY
+             ,SHARED_UNAVAILABLE
+};
+
+/* Result of parallel_data(): PARALLEL_SERIAL means that nothing was
+ * printed and the serial path has to answer (and report any errors).
+ */
+enum PARALLEL {PARALLEL_SUCCESS
+               ,PARALLEL_FAILURE
+               ,PARALLEL_SERIAL
 };
 
 #define UNKNOWN_DAYS "(unknown)"
 
+#ifndef DATA_DIR
 #define DATA_DIR "/usr/share/distro-info"
+#endif
 
 #define OUTDATED_ERROR "Distribution data outdated.\n" \
     "Please check for an update for distro-info-data. " \
     "See /usr/share/doc/distro-info-data/README.Debian for details."
 
+/* The CSV tokenizer looks for separators in blocks of this many bytes. */
+#define CSV_BLOCK 64
+
+/* --stream reads the data file in chunks of this many bytes. */
+#ifndef STREAM_CHUNK
+#define STREAM_CHUNK 65536
+#endif
+
+/* Files of at least this many bytes are parsed and filtered by a pool of
+ * worker threads (only for the options that list versions).
+ */
+#ifndef PARALLEL_THRESHOLD
+#define PARALLEL_THRESHOLD (1 << 20)
+#endif
+
+/* Number of worker threads of the parallel path. Defaults to the number of
+ * online processors (and the serial path on a single processor).
+ */
+#ifndef PARALLEL_THREADS
+#define PARALLEL_THREADS sysconf(_SC_NPROCESSORS_ONLN)
+#endif
+
+/* Size of an arena block in 64-bit words (unless one allocation needs more). */
+#define ARENA_BLOCK 8192
+
+typedef struct arena_block_s {
+    struct arena_block_s *next;
+    size_t size;
+    size_t used;
+    uint64_t data[];
+} arena_block_t;
+
+/* Bump allocator of one thread. Everything is freed at once. */
+typedef struct {
+    arena_block_t *blocks;
+} arena_t;
+
+/* Cursor of the CSV tokenizer: sep holds the positions of the not yet
+ * consumed commas and newlines in the block starting at block.
+ */
+typedef struct {
+    char *next;
+    char *block;
+    char *end;
+    uint64_t sep;
+} csv_reader_t;
+
+/* Where read_row() allocates the rows (with malloc() if arena is NULL) and
+ * how it reports invalid dates (only counted in failures if quiet is set).
+ */
+typedef struct {
+    const char *filename;
+    char *const *columns;
+    arena_t *arena;
+    bool quiet;
+    int failures;
+} row_parser_t;
+
 typedef struct {
     unsigned int year;
     unsigned int month;
@@ -71,17 +272,351 @@ typedef struct distro_elem_s {
     struct distro_elem_s *next;
 } distro_elem_t;
 
-static inline bool date_ge(const date_t *date1, const date_t *date2);
-static inline bool created(const date_t *date, const distro_t *distro);
-static inline bool released(const date_t *date, const distro_t *distro);
-static inline bool eol(const date_t *date, const distro_t *distro);
+/* A filter matches a row if all required and none of the excluded
+ * predicates (bit masks of PREDICATE values) hold for it.
+ */
+typedef struct {
+    const char *name;
+    unsigned int require;
+    unsigned int exclude;
+} filter_t;
+
+/* Dates packed as (year << 9 | month << 5 | day), which compare like
+ * date_ge() does.
+ */
+typedef uint32_t datekey_t;
+
+#define DATEKEY_ABSENT UINT32_MAX
+
+// Last year that fits into a datekey_t
+#define DATEKEY_YEAR_MAX (UINT32_MAX >> 9)
+
+#define ROWS_PER_WORD 64
+
+/* One lower case name (series, codename, or version) of the row. */
+typedef struct {
+    char *key;
+    size_t row;
+} name_t;
+
+/* Column-wise copy of a distro list. Every milestone is stored as one
+ * packed date column (DATEKEY_ABSENT for missing dates) and the static
+ * per-row properties as bit sets, so that filters can be evaluated for
+ * ROWS_PER_WORD rows at once. The columns are padded to a multiple of
+ * ROWS_PER_WORD entries. The names of all rows are kept sorted for
+ * prefix lookups and newest holds the rows ordered by release date (newest
+ * first, unreleased versions by creation date before all others) once
+ * table_newest() has sorted them.
+ */
+typedef struct {
+    size_t count;
+    size_t words;
+    const distro_t **rows;
+    name_t *names;
+    size_t n_names;
+    size_t *newest;
+    datekey_t *columns[MILESTONE_COUNT];
+    uint64_t *versioned;
+#ifdef UBUNTU
+    uint64_t *lts;
+#endif
+} distro_table_t;
+
+/* One row of a revision of a versioned data store. The rows are linked in
+ * the order of the data file; removed rows have no line, but stay in the
+ * index so that they can be added again.
+ */
+typedef struct {
+    const char *series;
+    size_t series_length;
+    const char *line;
+    size_t prev;
+    size_t next;
+} store_row_t;
+
+/* Rows of a revision, indexed by series in an open addressing hash table
+ * of row numbers (STORE_END marks empty slots and the ends of the list).
+ */
+typedef struct {
+    store_row_t *rows;
+    size_t count;
+    size_t capacity;
+    size_t *index;
+    size_t index_size;
+    size_t head;
+    size_t tail;
+} store_rows_t;
+
+#define STORE_END SIZE_MAX
+
+/* Revision of a versioned data store: its version and publication date. */
+typedef struct {
+    const char *version;
+    date_t date;
+} store_revision_t;
+
+/* Row of one layer of the overlay merge (see overlay_data_file()). The
+ * layer and position of a merged row are those of its first appearance.
+ */
+typedef struct {
+    const char *series;
+    size_t series_length;
+    const char *line;
+    size_t layer;
+    size_t position;
+} layer_row_t;
+
+typedef struct {
+    char *content;
+    layer_row_t *rows;
+    size_t count;
+    size_t next;
+} layer_t;
+
+/* Byte range of the line of one row in the content of a snapshot and the
+ * hash of its bytes before they were tokenized.
+ */
+typedef struct {
+    size_t offset;
+    size_t length;
+    uint64_t hash;
+} row_line_t;
+
+/* Immutable view of one data file: the parsed list, the buffer that its
+ * strings point into and the column table built from it. A snapshot is
+ * never modified after snapshot_load() and is freed when the last reference
+ * is released. A snapshot attached from shared memory has no content;
+ * its strings, dates, and columns point into mapping instead. Snapshots
+ * that are reloaded keep the lines of their rows (one per table row), so
+ * that snapshot_reload() only has to parse the rows that changed.
+ */
+typedef struct {
+    distro_elem_t *list;
+    char *content;
+    distro_table_t *table;
+    unsigned long references;
+    void *mapping;
+    size_t mapping_size;
+    row_line_t *lines;
+} snapshot_t;
+
+/* Series whose row snapshot_reload() added ('+'), changed ('='), or
+ * removed ('-'), like the changes of a data store.
+ */
+typedef struct {
+    char change;
+    char *series;
+} series_change_t;
+
+typedef struct {
+    series_change_t *changes;
+    size_t count;
+    size_t reused;
+} reload_t;
+
+#define SHARED_MAGIC "DSTINFO1"
+
+/* Layout of a snapshot in shared memory. All references are offsets, so
+ * that every process can map it at any address. The header is followed by
+ * the sections rows, dates, strings, columns, versioned, lts, names, and
+ * newest at the given offsets (see shared_layout()). complete is set last.
+ */
+typedef struct {
+    char magic[8];
+    uint32_t complete;
+    uint32_t abi;
+    int64_t creator;
+    // Identity of the data file
+    uint64_t dev;
+    uint64_t ino;
+    uint64_t file_size;
+    int64_t mtime;
+    int64_t mtime_nsec;
+    // Size of the sections
+    uint64_t count;
+    uint64_t words;
+    uint64_t n_names;
+    uint64_t n_dates;
+    uint64_t strings_size;
+    // Offsets of the sections
+    uint64_t rows;
+    uint64_t dates;
+    uint64_t strings;
+    uint64_t columns[MILESTONE_COUNT];
+    uint64_t versioned;
+    uint64_t lts;
+    uint64_t names;
+    uint64_t newest;
+    uint64_t size;
+} shared_header_t;
+
+/* One row of a shared snapshot: offsets into the strings and indices into
+ * the dates (SHARED_ABSENT for missing milestones).
+ */
+typedef struct {
+    uint32_t version;
+    uint32_t codename;
+    uint32_t series;
+    uint32_t milestones[MILESTONE_COUNT];
+} shared_row_t;
+
+typedef struct {
+    uint32_t key;
+    uint32_t row;
+} shared_name_t;
+
+#define SHARED_ABSENT UINT32_MAX
+
+/* Milestone date of one row (see row_events()). */
+typedef struct {
+    datekey_t key;
+    size_t row;
+} row_event_t;
+
+/* Set of positions with one summary bit per word of the set, so that the
+ * lowest and highest positions are found without scanning every word.
+ */
+typedef struct {
+    size_t words;
+    uint64_t *bits;
+    uint64_t *summary;
+} rank_set_t;
+
+/* Order of the rows that the select callbacks compare: by creation or by
+ * release date (and by row for equal dates).
+ */
+enum RANK {RANK_CREATED
+           ,RANK_RELEASE
+           ,RANK_COUNT
+};
+
+/* What a sweep selects: the row that select_cb picks among the rows that
+ * match filter.
+ */
+typedef struct {
+    const filter_t *filter;
+    const distro_t *(*select_cb)(const distro_elem_t*);
+} selector_t;
+
+/* State of a sweep through the milestone dates of a table: its milestone
+ * events in date order and the predicates of every row at the current
+ * date. For every selector, the rows that match its filter are kept in
+ * row order and ranked by the date that its select callback compares.
+ */
+typedef struct {
+    const distro_table_t *table;
+    const selector_t *selectors;
+    size_t n_selectors;
+    row_event_t *events;
+    size_t n_events;
+    size_t next;
+    unsigned int *predicates;
+    size_t *rank[RANK_COUNT];
+    size_t *ranked[RANK_COUNT];
+    rank_set_t *rows;
+    rank_set_t *ranks;
+} sweep_t;
+
+/* State of the --diff sweep over both data files. A unit is a series:
+ * units maps the rows of each file to their unit, unit_rows the units to
+ * the rows of both files with that series (SIZE_MAX if one file does not
+ * have it), and same_names tells whether they have the same version and
+ * codename. mismatches counts the units that the answer of every list
+ * filter shows differently.
+ */
+typedef struct {
+    sweep_t sides[2];
+    size_t *units[2];
+    size_t *unit_rows[2];
+    bool *same_names;
+    size_t n_units;
+    size_t *mismatches;
+} diff_t;
+
+/* Publication point for snapshots that are shared between threads.
+ * Readers announce themselves in the counter of the current epoch while
+ * they take a reference, so that a publisher knows when no reader can
+ * still pick up the snapshot it replaced. Readers never wait; publishers
+ * wait for the short window in which a reader takes its reference.
+ */
+typedef struct {
+    snapshot_t *current;
+    unsigned long epoch;
+    unsigned long readers[2];
+    bool publishing;
+} snapshot_store_t;
+
+enum EXPR_OP {EXPR_PREDICATE
+             ,EXPR_SERIES
+             ,EXPR_VERSION
+             ,EXPR_NOT
+             ,EXPR_AND
+             ,EXPR_OR
+};
+
+/* One step of a compiled --query expression. The steps are stored in
+ * postfix order and evaluated on a stack of row bit sets.
+ */
+typedef struct {
+    enum EXPR_OP op;
+    int predicate;
+    datekey_t key;          // DATEKEY_ABSENT: evaluate at the query date
+    char *text;
+} expr_op_t;
+
+typedef struct {
+    char *source;
+    size_t length;
+    expr_op_t *ops;
+} expr_t;
+
+/* A role of the other vendor for --join: select_cb picks the distribution
+ * among those that match filter (with the predicates of the other vendor).
+ */
+typedef struct {
+    const char *name;
+    filter_t filter;
+    const distro_t *(*select_cb)(const distro_elem_t*);
+} join_role_t;
+
+/* Everything given on the command line that determines the answer,
+ * except for the date.
+ */
+typedef struct {
+    const filter_t *filter;
+    const expr_t *expr;
+    const distro_t *(*select_cb)(const distro_elem_t*);
+    const char *series;
 #ifdef DEBIAN
-static inline bool eol_lts(const date_t *date, const distro_t *distro);
-static inline bool eol_elts(const date_t *date, const distro_t *distro);
+    const char *alias;
 #endif
 #ifdef UBUNTU
-static inline bool eol_esm(const date_t *date, const distro_t *distro);
+    bool latest;
 #endif
+    int date_index;
+    int just_days;
+    bool (*print_cb)(FILE*, const distro_t*, const date_t*, int, int);
+    size_t limit;
+    enum ORDER order;
+} query_t;
+
+/* Pull-based iterator over the rows of a table that match a filter at a
+ * date (see cursor_next()). The filter is only evaluated for the words of
+ * rows that are reached, so stopping early skips the rest of the table.
+ */
+typedef struct {
+    const distro_table_t *table;
+    const filter_t *filter;
+    datekey_t key;
+    enum ORDER order;
+    size_t position;
+    uint64_t matched;
+    const size_t *newest;
+    uint64_t *words;
+    bool *evaluated;
+} cursor_t;
+
+static inline bool date_ge(const date_t *date1, const date_t *date2);
 static inline int milestone_to_index(const char *milestone);
 
 #endif // __DISTRO_INFO_UTIL_H__
@@ -0,0 +1,384 @@
+/*
+ * Copyright (C) 2026, agent <agent@local>
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+/* Stress test for the snapshot store: reader threads query the published
+ * snapshot in a tight loop while one thread keeps reloading two different
+ * data files. Every snapshot a reader sees has to be complete and belong to
+ * exactly one of the files, and the readers have to make progress during
+ * the reloads. Afterwards, edited versions of a data file are reloaded
+ * incrementally and compared with a full load.
+ */
+
+#define DISTRO_INFO_NO_MAIN
+#include "debian-distro-info.c"
+
+#include <ctype.h>
+#include <pthread.h>
+
+#define READERS 8
+#define RELOADS 2000
+
+typedef struct {
+    const char *filename;
+    char prefix;
+    size_t count;
+} generation_t;
+
+typedef struct {
+    snapshot_store_t *store;
+    unsigned long queries;
+    unsigned long queries_during_reloads;
+    unsigned long failures;
+} reader_t;
+
+static generation_t generations[2] = {
+    {NULL, 'a', 3},
+    {NULL, 'b', 70},
+};
+
+static bool reloading = true;
+static bool running = true;
+
+static char *write_generation(const char *directory, const generation_t *generation) {
+    char *filename;
+    FILE *f;
+    size_t i;
+
+    filename = malloc(strlen(directory) + 16);
+    sprintf(filename, "%s/%c.csv", directory, generation->prefix);
+    f = fopen(filename, "w");
+    fprintf(f, CSV_HEADER "\n");
+    for(i = 0; i < generation->count; i++) {
+        fprintf(f, "%zu,%c%zu,%c%zu,%04zu-01-01,%04zu-06-01,%04zu-06-01\n",
+                i + 1, toupper(generation->prefix), i, generation->prefix, i,
+                1990 + i, 1991 + i, 1994 + i);
+    }
+    fclose(f);
+    return filename;
+}
+
+/* Check that snapshot is one complete generation and query it. */
+static bool check_snapshot(const snapshot_t *snapshot) {
+    const generation_t *generation;
+    const distro_elem_t *current;
+    const distro_table_t *table = snapshot->table;
+    datekey_t key = date_to_key(&(date_t){2000, 1, 1});
+    size_t matched = 0;
+    size_t row;
+    size_t word;
+
+    generation = snapshot->list->distro->series[0] == generations[0].prefix
+                 ? &generations[0] : &generations[1];
+    if(table->count != generation->count) {
+        return false;
+    }
+    for(row = 0, current = snapshot->list; current != NULL;
+        row++, current = current->next) {
+        if(row >= table->count || table->rows[row] != current->distro ||
+           current->distro->series[0] != generation->prefix) {
+            return false;
+        }
+    }
+    if(row != generation->count) {
+        return false;
+    }
+    for(word = 0; word < table->words; word++) {
+        matched += __builtin_popcountll(table_filter(table, &filter_supported,
+                                                     key, word));
+    }
+    // Rows 6 to 10 are created and not end of life on 2000-01-01.
+    return matched == (generation->count > 10 ? 5 : 0);
+}
+
+static void *reader(void *arg) {
+    reader_t *state = arg;
+    snapshot_t *snapshot;
+
+    while(__atomic_load_n(&running, __ATOMIC_RELAXED)) {
+        snapshot = snapshot_acquire(state->store);
+        if(snapshot == NULL || !check_snapshot(snapshot)) {
+            state->failures++;
+        }
+        snapshot_release(snapshot);
+        state->queries++;
+        if(__atomic_load_n(&reloading, __ATOMIC_RELAXED)) {
+            __atomic_add_fetch(&state->queries_during_reloads, 1, __ATOMIC_RELAXED);
+        }
+    }
+    return NULL;
+}
+
+static bool same_string(const char *a, const char *b) {
+    return a == b || (a != NULL && b != NULL && strcmp(a, b) == 0);
+}
+
+/* Check that the incrementally reloaded snapshot equals a full load. */
+static bool same_snapshot(const snapshot_t *reloaded, const snapshot_t *loaded) {
+    const distro_table_t *a = reloaded->table;
+    const distro_table_t *b = loaded->table;
+    int milestone_index;
+    size_t row;
+
+    if(a->count != b->count || a->n_names != b->n_names) {
+        return false;
+    }
+    for(row = 0; row < a->count; row++) {
+        if(!same_string(a->rows[row]->version, b->rows[row]->version) ||
+           !same_string(a->rows[row]->codename, b->rows[row]->codename) ||
+           !same_string(a->rows[row]->series, b->rows[row]->series) ||
+           table_newest(a)[row] != table_newest(b)[row]) {
+            return false;
+        }
+        for(milestone_index = 0; milestone_index < (int)MILESTONE_COUNT;
+            milestone_index++) {
+            if(a->columns[milestone_index][row] != b->columns[milestone_index][row]) {
+                return false;
+            }
+        }
+    }
+    for(row = 0; row < a->n_names; row++) {
+        if(strcmp(a->names[row].key, b->names[row].key) != 0 ||
+           a->names[row].row != b->names[row].row) {
+            return false;
+        }
+    }
+    return memcmp(a->versioned, b->versioned, a->words * sizeof(uint64_t)) == 0;
+}
+
+static const char *format_changes(const reload_t *reload) {
+    static char buffer[256];
+    size_t length = 0;
+    size_t i;
+
+    buffer[0] = '\0';
+    for(i = 0; i < reload->count; i++) {
+        length += snprintf(buffer + length, sizeof(buffer) - length, "%s%c%s",
+                           i > 0 ? " " : "", reload->changes[i].change,
+                           reload->changes[i].series);
+    }
+    return buffer;
+}
+
+/* Reload edited versions of a data file incrementally. Every reload has to
+ * give the same snapshot as a full load and report the changed series.
+ */
+/* Redirect stderr into a temporary file. Returns the saved stderr for
+ * end_capture().
+ */
+static int start_capture(FILE **captured) {
+    const int saved = dup(STDERR_FILENO);
+
+    fflush(stderr);
+    *captured = tmpfile();
+    dup2(fileno(*captured), STDERR_FILENO);
+    return saved;
+}
+
+/* Restore the saved stderr and return what was written to it in the
+ * meantime. The caller has to free the returned string.
+ */
+static char *end_capture(int saved, FILE *captured) {
+    char *output;
+    long size;
+
+    fflush(stderr);
+    dup2(saved, STDERR_FILENO);
+    close(saved);
+    size = ftell(captured);
+    output = calloc(size + 1, sizeof(char));
+    rewind(captured);
+    if(fread(output, sizeof(char), size, captured) != (size_t)size) {
+        output[0] = '\0';
+    }
+    fclose(captured);
+    return output;
+}
+
+static int test_incremental(const char *directory) {
+    static const struct {
+        const char *rows;
+        const char *changes;
+        const char *error;
+    } steps[] = {
+        {"1,A,a,1990-01-01,1991-01-01,1994-01-01\n"
+         "2,B,b,1992-01-01,1993-01-01\n"
+         "# comment\n"
+         ",C,c,1993-01-01\n", NULL, ""},
+        // Edited, appended, and touched without changes
+        {"1,A,a,1990-01-01,1991-01-01,1994-01-01\n"
+         "2,B,b,1992-01-01,1993-01-01,1998-01-01\n"
+         "# comment\n"
+         ",C,c,1993-01-01\n"
+         ",D,d,1995-01-01\n", "=b +d", ""},
+        {"1,A,a,1990-01-01,1991-01-01,1994-01-01\n"
+         "2,B,b,1992-01-01,1993-01-01,1998-01-01\n"
+         "# comment\n"
+         ",C,c,1993-01-01\n"
+         ",D,d,1995-01-01\n", "", ""},
+        // Inserted and removed
+        {"0,Z,z,1989-01-01\n"
+         "\n"
+         "1,A,a,1990-01-01,1991-01-01,1994-01-01\n"
+         "2,B,b,1992-01-01,1993-01-01,1998-01-01\n"
+         ",D,d,1995-01-01\n", "+z -c", ""},
+        // Moved rows (the names and newest order are built again)
+        {",D,d,1995-01-01\n"
+         "0,Z,z,1989-01-01\n"
+         "1,A,a,1990-01-01,1991-01-01,1994-01-01\n"
+         "2,B,b,1992-01-01,1993-01-01,1998-01-01", "", ""},
+        // Invalid rows keep the published snapshot
+        {"1,A,a,1990-13-01\n", NULL, "Invalid date `1990-13-01'"},
+    };
+    snapshot_store_t store = {NULL, 0, {0, 0}, false};
+    snapshot_t *reloaded;
+    snapshot_t *loaded;
+    reload_t reload;
+    char *filename = malloc(strlen(directory) + 16);
+    char *error;
+    size_t step;
+    FILE *captured;
+    FILE *f;
+    int saved;
+    int failures = 0;
+    bool reloaded_ok;
+
+    sprintf(filename, "%s/edited.csv", directory);
+    for(step = 0; step < sizeof(steps) / sizeof(steps[0]); step++) {
+        f = fopen(filename, "w");
+        fprintf(f, CSV_HEADER "\n%s", steps[step].rows);
+        fclose(f);
+        saved = start_capture(&captured);
+        reloaded_ok = snapshot_reload(&store, filename, &reload);
+        error = end_capture(saved, captured);
+        if(steps[step].error[0] == '\0' ? error[0] != '\0'
+                                        : strstr(error, steps[step].error) == NULL) {
+            fprintf(stderr, "test-snapshot: reload %zu reported `%s' instead of "
+                    "`%s'.\n", step, error, steps[step].error);
+            failures++;
+        }
+        free(error);
+        if(!reloaded_ok) {
+            if(step + 1 < sizeof(steps) / sizeof(steps[0])) {
+                fprintf(stderr, "test-snapshot: reload %zu failed.\n", step);
+                failures++;
+            }
+            continue;
+        }
+        reloaded = snapshot_acquire(&store);
+        loaded = snapshot_load(filename);
+        if(!same_snapshot(reloaded, loaded)) {
+            fprintf(stderr, "test-snapshot: reload %zu differs from a full load.\n",
+                    step);
+            failures++;
+        }
+        if(steps[step].changes != NULL &&
+           strcmp(format_changes(&reload), steps[step].changes) != 0) {
+            fprintf(stderr, "test-snapshot: reload %zu reported `%s' instead of "
+                    "`%s'.\n", step, format_changes(&reload), steps[step].changes);
+            failures++;
+        }
+        snapshot_release(loaded);
+        snapshot_release(reloaded);
+        free_reload(&reload);
+    }
+    reloaded = snapshot_acquire(&store);
+    if(reloaded == NULL || reloaded->table->count != 4) {
+        fprintf(stderr, "test-snapshot: an invalid file replaced the snapshot.\n");
+        failures++;
+    }
+    snapshot_release(reloaded);
+    snapshot_publish(&store, NULL);
+    unlink(filename);
+    free(filename);
+    return failures;
+}
+
+static bool all_progressed(const reader_t *readers) {
+    int i;
+
+    for(i = 0; i < READERS; i++) {
+        if(__atomic_load_n(&readers[i].queries_during_reloads, __ATOMIC_RELAXED) == 0) {
+            return false;
+        }
+    }
+    return true;
+}
+
+int main(void) {
+    char directory[] = "/tmp/test-snapshot.XXXXXX";
+    snapshot_store_t store = {NULL, 0, {0, 0}, false};
+    pthread_t threads[READERS];
+    reader_t readers[READERS];
+    unsigned long failures = 0;
+    int return_value = EXIT_SUCCESS;
+    int i;
+
+    if(mkdtemp(directory) == NULL) {
+        perror("test-snapshot: mkdtemp");
+        return EXIT_FAILURE;
+    }
+    for(i = 0; i < 2; i++) {
+        generations[i].filename = write_generation(directory, &generations[i]);
+    }
+
+    if(!snapshot_reload(&store, generations[0].filename, NULL)) {
+        return EXIT_FAILURE;
+    }
+    for(i = 0; i < READERS; i++) {
+        readers[i] = (reader_t){&store, 0, 0, 0};
+        pthread_create(&threads[i], NULL, reader, &readers[i]);
+    }
+    /* Keep reloading until every reader got through at least one query in
+     * between the reloads (a blocked reader would never do so).
+     */
+    for(i = 1; i <= RELOADS || (i <= 100 * RELOADS && !all_progressed(readers));
+        i++) {
+        if(!snapshot_reload(&store, generations[i % 2].filename, NULL)) {
+            failures++;
+        }
+    }
+    __atomic_store_n(&reloading, false, __ATOMIC_RELAXED);
+    __atomic_store_n(&running, false, __ATOMIC_RELAXED);
+
+    for(i = 0; i < READERS; i++) {
+        pthread_join(threads[i], NULL);
+        failures += readers[i].failures;
+        if(readers[i].queries_during_reloads == 0) {
+            fprintf(stderr, "test-snapshot: reader %i made no progress during "
+                    "the reloads.\n", i);
+            return_value = EXIT_FAILURE;
+        }
+    }
+    snapshot_publish(&store, NULL);
+    if(test_incremental(directory) > 0) {
+        return_value = EXIT_FAILURE;
+    }
+
+    for(i = 0; i < 2; i++) {
+        unlink(generations[i].filename);
+        free((char *)generations[i].filename);
+    }
+    rmdir(directory);
+
+    if(failures > 0) {
+        fprintf(stderr, "test-snapshot: %lu inconsistent snapshots.\n", failures);
+        return_value = EXIT_FAILURE;
+    }
+    if(return_value == EXIT_SUCCESS) {
+        printf("test-snapshot: %i readers, %i reloads: OK\n", READERS, RELOADS);
+    }
+    return return_value;
+}
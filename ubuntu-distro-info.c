@@ -20,18 +20,9 @@
 #define DISTRO_NAME "Ubuntu"
 #define NAME "ubuntu-distro-info"
 
-// C standard libraries
-#include <string.h>
+// fopencookie() for the output of the parallel workers
+#define _GNU_SOURCE
 
 #include "distro-info-util.h"
 
-static bool filter_devel(const date_t *date, const distro_t *distro) {
-    return created(date, distro) && !released(date, distro);
-}
-
-static bool filter_lts(const date_t *date, const distro_t *distro) {
-    return strstr(distro->version, "LTS") != NULL &&
-           released(date, distro) && !eol(date, distro);
-}
-
 #include "distro-info-util.c"